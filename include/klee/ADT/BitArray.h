@@ -10,30 +10,39 @@
 #ifndef KLEE_BITARRAY_H
 #define KLEE_BITARRAY_H
 
+#include "klee/ADT/CopyOnWriteArray.h"
+
+#include <cassert>
+#include <cstdint>
+
 namespace klee {
 
-  // XXX would be nice not to have
-  // two allocations here for allocated
-  // BitArrays
+/// Bit array whose copies share storage until they are written, see
+/// CopyOnWriteArray.
 class BitArray {
 private:
-  uint32_t *bits;
+  CopyOnWriteArray<uint32_t> bits;
   
 protected:
   static uint32_t length(unsigned size) { return (size+31)/32; }
 
 public:
-  BitArray(unsigned size, bool value = false) : bits(new uint32_t[length(size)]) {
-    memset(bits, value?0xFF:0, sizeof(*bits)*length(size));
-  }
-  BitArray(const BitArray &b, unsigned size) : bits(new uint32_t[length(size)]) {
-    memcpy(bits, b.bits, sizeof(*bits)*length(size));
+  BitArray(unsigned size, bool value = false)
+      : bits(length(size), value ? 0xFFFFFFFF : 0) {}
+  BitArray(const BitArray &b, unsigned size) : bits(b.bits) {
+    assert(bits.size() == length(size) && "copy with different size");
   }
-  ~BitArray() { delete[] bits; }
 
-  bool get(unsigned idx) { return (bool) ((bits[idx/32]>>(idx&0x1F))&1); }
-  void set(unsigned idx) { bits[idx/32] |= 1<<(idx&0x1F); }
-  void unset(unsigned idx) { bits[idx/32] &= ~(1<<(idx&0x1F)); }
+  bool get(unsigned idx) const { return (bool) ((bits[idx/32]>>(idx&0x1F))&1); }
+  // Only unshare storage if the bit actually changes
+  void set(unsigned idx) {
+    if (!get(idx))
+      bits.getWriteable(idx/32) |= 1<<(idx&0x1F);
+  }
+  void unset(unsigned idx) {
+    if (get(idx))
+      bits.getWriteable(idx/32) &= ~(1<<(idx&0x1F));
+  }
   void set(unsigned idx, bool value) { if (value) set(idx); else unset(idx); }
 };
 
@@ -0,0 +1,168 @@
+//===-- CopyOnWriteArray.h --------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_COPYONWRITEARRAY_H
+#define KLEE_COPYONWRITEARRAY_H
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace klee {
+  /// Fixed-size array whose storage is split into reference counted pages
+  /// of (at most) 4KB. Copies share all pages, and a page is only copied
+  /// when it is written to while shared. Copying an array is thus
+  /// proportional to its number of pages, and writing after a copy to the
+  /// number of pages touched.
+  ///
+  /// An array of size 0 is empty, which callers may use to represent a
+  /// missing array.
+  template<class T>
+  class CopyOnWriteArray {
+  private:
+    static constexpr unsigned PageBytes = 4096;
+    static constexpr unsigned PageSize =
+        sizeof(T) >= PageBytes ? 1 : PageBytes / sizeof(T);
+    static_assert((PageSize & (PageSize - 1)) == 0,
+                  "page size must be a power of two");
+
+    struct alignas(T) alignas(unsigned) Page {
+      unsigned references;
+      const unsigned size;
+
+      explicit Page(unsigned _size) : references(1), size(_size) {}
+
+      T *data() { return reinterpret_cast<T *>(this + 1); }
+      const T *data() const { return reinterpret_cast<const T *>(this + 1); }
+
+      static Page *allocate(unsigned size) {
+        void *mem = ::operator new(sizeof(Page) + size * sizeof(T));
+        return new (mem) Page(size);
+      }
+      static Page *create(unsigned size, const T &value) {
+        Page *p = allocate(size);
+        std::uninitialized_fill_n(p->data(), size, value);
+        return p;
+      }
+      static Page *copy(const Page *other) {
+        Page *p = allocate(other->size);
+        std::uninitialized_copy(other->data(), other->data() + other->size,
+                                p->data());
+        return p;
+      }
+      static void release(Page *p) {
+        if (--p->references)
+          return;
+        for (unsigned i = 0; i != p->size; ++i)
+          p->data()[i].~T();
+        p->~Page();
+        ::operator delete(p);
+      }
+    };
+
+    std::vector<Page *> pages;
+    unsigned length;
+
+    /// Returns the page at index, copying it first if it is shared.
+    Page *getWriteablePage(unsigned index) {
+      Page *&p = pages[index];
+      if (p->references > 1) {
+        Page *copy = Page::copy(p);
+        Page::release(p);
+        p = copy;
+      }
+      return p;
+    }
+
+  public:
+    CopyOnWriteArray() : length(0) {}
+    explicit CopyOnWriteArray(unsigned size, const T &value = T())
+        : length(size) {
+      pages.reserve((size + PageSize - 1) / PageSize);
+      for (unsigned i = 0; i < size; i += PageSize)
+        pages.push_back(Page::create(std::min(PageSize, size - i), value));
+    }
+    CopyOnWriteArray(const CopyOnWriteArray &b)
+        : pages(b.pages), length(b.length) {
+      for (Page *p : pages)
+        ++p->references;
+    }
+    ~CopyOnWriteArray() {
+      for (Page *p : pages)
+        Page::release(p);
+    }
+
+    CopyOnWriteArray &operator=(const CopyOnWriteArray &b) {
+      for (Page *p : b.pages)
+        ++p->references;
+      for (Page *p : pages)
+        Page::release(p);
+      pages = b.pages;
+      length = b.length;
+      return *this;
+    }
+
+    bool empty() const { return length == 0; }
+    unsigned size() const { return length; }
+
+    const T &operator[](unsigned idx) const {
+      assert(idx < length && "out of bounds access");
+      return pages[idx / PageSize]->data()[idx % PageSize];
+    }
+    /// Returns a reference to the element at idx that can be written, after
+    /// unsharing the page it is stored in.
+    T &getWriteable(unsigned idx) {
+      assert(idx < length && "out of bounds access");
+      return getWriteablePage(idx / PageSize)->data()[idx % PageSize];
+    }
+    void set(unsigned idx, const T &value) { getWriteable(idx) = value; }
+
+    /// Sets all elements to value. Shared pages are replaced, not copied.
+    void fill(const T &value) {
+      for (Page *&p : pages) {
+        if (p->references > 1) {
+          Page *fresh = Page::create(p->size, value);
+          Page::release(p);
+          p = fresh;
+        } else {
+          std::fill(p->data(), p->data() + p->size, value);
+        }
+      }
+    }
+
+    /// Copies all elements to the (size() elements long) buffer dst.
+    void copyTo(T *dst) const {
+      for (const Page *p : pages)
+        dst = std::copy(p->data(), p->data() + p->size, dst);
+    }
+    /// Returns true if all elements equal those in the buffer src.
+    bool equals(const T *src) const {
+      for (const Page *p : pages) {
+        if (!std::equal(p->data(), p->data() + p->size, src))
+          return false;
+        src += p->size;
+      }
+      return true;
+    }
+    /// Copies all elements from the buffer src. Only pages whose contents
+    /// change are unshared.
+    void copyFrom(const T *src) {
+      for (unsigned i = 0, e = pages.size(); i != e; ++i) {
+        unsigned size = pages[i]->size;
+        if (!std::equal(src, src + size, pages[i]->data()))
+          std::copy(src, src + size, getWriteablePage(i)->data());
+        src += size;
+      }
+    }
+  };
+}
+
+#endif /* KLEE_COPYONWRITEARRAY_H */
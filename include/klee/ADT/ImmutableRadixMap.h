@@ -0,0 +1,481 @@
+//===-- ImmutableRadixMap.h -------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_IMMUTABLERADIXMAP_H
+#define KLEE_IMMUTABLERADIXMAP_H
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace klee {
+  /// Persistent ordered map from keys that can be mapped to unsigned 64-bit
+  /// integers (addresses), with the interface of ImmutableMap.
+  ///
+  /// The map is a path-compressed radix tree with 16-way nodes. Each node
+  /// stores its children in a dense array indexed through a bitmap, as in a
+  /// hash array mapped trie. Copying a map is O(1), updates copy the path to
+  /// the changed leaf and lookups touch one node per 4 significant bits in
+  /// which the keys differ, independent of the number of entries.
+  ///
+  /// \tparam KeyOf Function object returning the integer for a key. Keys are
+  /// ordered by it and two keys with the same integer are the same key.
+  template<class K, class D, class KeyOf>
+  class ImmutableRadixMap {
+  public:
+    typedef K key_type;
+    typedef std::pair<K,D> value_type;
+    class iterator;
+
+  private:
+    static constexpr unsigned Bits = 4;
+    static constexpr unsigned Fanout = 1u << Bits;
+    static constexpr unsigned MaxDepth = 64 / Bits + 1;
+
+    struct Entry {
+      mutable unsigned references;
+      const bool isLeaf;
+      explicit Entry(bool _isLeaf) : references(0), isLeaf(_isLeaf) {}
+    };
+
+    struct Leaf : Entry {
+      const uint64_t key;
+      const value_type value;
+      Leaf(uint64_t _key, const value_type &_value)
+          : Entry(true), key(_key), value(_value) {}
+    };
+
+    /// Inner node. All keys below it agree on the bits above
+    /// shift + Bits, which are stored in prefix, and it has at least two
+    /// children.
+    struct Node : Entry {
+      const unsigned shift;
+      const uint64_t prefix;
+      const uint32_t bitmap;
+      const std::size_t size;
+
+      Node(unsigned _shift, uint64_t _prefix, uint32_t _bitmap,
+           std::size_t _size)
+          : Entry(false), shift(_shift), prefix(_prefix), bitmap(_bitmap),
+            size(_size) {}
+
+      unsigned count() const { return __builtin_popcount(bitmap); }
+      const Entry **children() {
+        return reinterpret_cast<const Entry **>(this + 1);
+      }
+      const Entry *const *children() const {
+        return reinterpret_cast<const Entry *const *>(this + 1);
+      }
+      const Entry *child(unsigned pos) const { return children()[pos]; }
+
+      /// Lowest and highest key this node can hold
+      uint64_t low() const {
+        return shift + Bits >= 64 ? 0 : prefix << (shift + Bits);
+      }
+      uint64_t high() const {
+        return shift + Bits >= 64 ? ~0ULL
+                                  : low() | ((1ULL << (shift + Bits)) - 1);
+      }
+      bool covers(uint64_t key) const {
+        return low() <= key && key <= high();
+      }
+      unsigned index(uint64_t key) const {
+        return (key >> shift) & (Fanout - 1);
+      }
+      /// Position in children() of the first child with index >= idx
+      unsigned position(unsigned idx) const {
+        return __builtin_popcount(bitmap & ((1u << idx) - 1));
+      }
+
+      static Node *create(unsigned shift, uint64_t prefix, uint32_t bitmap,
+                          std::size_t size) {
+        void *mem = ::operator new(
+            sizeof(Node) + __builtin_popcount(bitmap) * sizeof(Entry *));
+        return new (mem) Node(shift, prefix, bitmap, size);
+      }
+    };
+
+    const Entry *root;
+
+    explicit ImmutableRadixMap(const Entry *_root) : root(_root) {}
+
+    static const Entry *incref(const Entry *e) {
+      if (e)
+        ++e->references;
+      return e;
+    }
+    static void decref(const Entry *e) {
+      if (!e || --e->references)
+        return;
+      if (e->isLeaf) {
+        delete static_cast<const Leaf *>(e);
+      } else {
+        const Node *n = static_cast<const Node *>(e);
+        for (unsigned i = 0, c = n->count(); i != c; ++i)
+          decref(n->child(i));
+        n->~Node();
+        ::operator delete(const_cast<Node *>(n));
+      }
+    }
+
+    static std::size_t sizeOf(const Entry *e) {
+      if (!e)
+        return 0;
+      return e->isLeaf ? 1 : static_cast<const Node *>(e)->size;
+    }
+    /// Some key below e, only its bits above the bottom of e are relevant
+    static uint64_t keyOf(const Entry *e) {
+      return e->isLeaf ? static_cast<const Leaf *>(e)->key
+                       : static_cast<const Node *>(e)->low();
+    }
+
+    /// Creates a node with the two given (owned) entries, whose key ranges
+    /// must be disjoint.
+    static const Entry *join(const Entry *a, const Entry *b) {
+      uint64_t ka = keyOf(a), kb = keyOf(b);
+      unsigned highBit = 63 - __builtin_clzll(ka ^ kb);
+      unsigned shift = highBit / Bits * Bits;
+      uint64_t prefix = shift + Bits >= 64 ? 0 : ka >> (shift + Bits);
+      unsigned ia = (ka >> shift) & (Fanout - 1);
+      unsigned ib = (kb >> shift) & (Fanout - 1);
+      assert(ia != ib && "entries are not disjoint");
+      Node *n = Node::create(shift, prefix, (1u << ia) | (1u << ib),
+                             sizeOf(a) + sizeOf(b));
+      n->children()[ia < ib ? 0 : 1] = a;
+      n->children()[ia < ib ? 1 : 0] = b;
+      return incref(n);
+    }
+
+    /// Copy of n with the child at position pos replaced by (owned) child,
+    /// or removed if child is null. Other children are shared.
+    static const Entry *copyWith(const Node *n, unsigned idx,
+                                 const Entry *child) {
+      unsigned pos = n->position(idx);
+      bool present = n->bitmap & (1u << idx);
+      std::size_t size = n->size + sizeOf(child) -
+                         (present ? sizeOf(n->child(pos)) : 0);
+      uint32_t bitmap = child ? n->bitmap | (1u << idx)
+                              : n->bitmap & ~(1u << idx);
+      Node *copy = Node::create(n->shift, n->prefix, bitmap, size);
+      const Entry **out = copy->children();
+      for (unsigned i = 0, c = n->count(); i != c; ++i) {
+        if (i == pos) {
+          if (child)
+            *out++ = child;
+          if (present)
+            continue;
+        }
+        *out++ = incref(n->child(i));
+      }
+      if (pos == n->count() && child)
+        *out++ = child;
+      return incref(copy);
+    }
+
+    /// Returns e with value inserted, as an owned entry.
+    static const Entry *insert(const Entry *e, uint64_t key,
+                               const value_type &value, bool replace) {
+      if (!e)
+        return incref(new Leaf(key, value));
+
+      if (e->isLeaf) {
+        const Leaf *l = static_cast<const Leaf *>(e);
+        if (l->key != key)
+          return join(incref(l), incref(new Leaf(key, value)));
+        return replace ? incref(new Leaf(key, value)) : incref(l);
+      }
+
+      const Node *n = static_cast<const Node *>(e);
+      if (!n->covers(key))
+        return join(incref(n), incref(new Leaf(key, value)));
+
+      unsigned idx = n->index(key);
+      const Entry *child = nullptr;
+      if (n->bitmap & (1u << idx))
+        child = n->child(n->position(idx));
+      const Entry *updated = insert(child, key, value, replace);
+      if (updated == child) {
+        decref(updated);
+        return incref(n);
+      }
+      return copyWith(n, idx, updated);
+    }
+
+    /// Returns e without key, as an owned entry.
+    static const Entry *remove(const Entry *e, uint64_t key) {
+      if (!e)
+        return nullptr;
+
+      if (e->isLeaf)
+        return static_cast<const Leaf *>(e)->key == key ? nullptr : incref(e);
+
+      const Node *n = static_cast<const Node *>(e);
+      unsigned idx = n->index(key);
+      if (!n->covers(key) || !(n->bitmap & (1u << idx)))
+        return incref(n);
+
+      unsigned pos = n->position(idx);
+      const Entry *child = n->child(pos);
+      const Entry *updated = remove(child, key);
+      if (updated == child) {
+        decref(updated);
+        return incref(n);
+      }
+      // A node with a single child is replaced by that child
+      if (!updated && n->count() == 2)
+        return incref(n->child(1 - pos));
+      return copyWith(n, idx, updated);
+    }
+
+    static const Leaf *find(const Entry *e, uint64_t key) {
+      while (e && !e->isLeaf) {
+        const Node *n = static_cast<const Node *>(e);
+        unsigned idx = n->index(key);
+        if (!n->covers(key) || !(n->bitmap & (1u << idx)))
+          return nullptr;
+        e = n->child(n->position(idx));
+      }
+      const Leaf *l = static_cast<const Leaf *>(e);
+      return l && l->key == key ? l : nullptr;
+    }
+
+    static const Leaf *last(const Entry *e) {
+      while (e && !e->isLeaf) {
+        const Node *n = static_cast<const Node *>(e);
+        e = n->child(n->count() - 1);
+      }
+      return static_cast<const Leaf *>(e);
+    }
+
+    /// Last leaf whose key is <= key. Unlike bound, this remembers only the
+    /// closest subtree to the left of the search path.
+    static const Leaf *findPrevious(const Entry *e, uint64_t key) {
+      const Entry *left = nullptr;
+      while (e && !e->isLeaf) {
+        const Node *n = static_cast<const Node *>(e);
+        if (key < n->low())
+          return last(left);
+        if (key > n->high())
+          return last(n);
+        unsigned idx = n->index(key);
+        unsigned pos = n->position(idx);
+        if (pos)
+          left = n->child(pos - 1);
+        if (!(n->bitmap & (1u << idx)))
+          return last(left);
+        e = n->child(pos);
+      }
+      const Leaf *l = static_cast<const Leaf *>(e);
+      return l && l->key <= key ? l : last(left);
+    }
+
+    /// First element whose key is > key (strict) or >= key (otherwise).
+    iterator bound(uint64_t key, bool strict) const;
+
+  public:
+    ImmutableRadixMap() : root(nullptr) {}
+    ImmutableRadixMap(const ImmutableRadixMap &b) : root(incref(b.root)) {}
+    ~ImmutableRadixMap() { decref(root); }
+
+    ImmutableRadixMap &operator=(const ImmutableRadixMap &b) {
+      const Entry *old = root;
+      root = incref(b.root);
+      decref(old);
+      return *this;
+    }
+
+    bool empty() const { return !root; }
+    std::size_t count(const key_type &key) const {
+      return find(root, KeyOf()(key)) ? 1 : 0;
+    }
+    const value_type *lookup(const key_type &key) const {
+      const Leaf *l = find(root, KeyOf()(key));
+      return l ? &l->value : nullptr;
+    }
+    /// Returns the last value less than or equal to key, or null if no such
+    /// value exists.
+    const value_type *lookup_previous(const key_type &key) const {
+      const Leaf *l = findPrevious(root, KeyOf()(key));
+      return l ? &l->value : nullptr;
+    }
+    const value_type &min() const { return *begin(); }
+    const value_type &max() const { return last(root)->value; }
+    std::size_t size() const { return sizeOf(root); }
+
+    ImmutableRadixMap insert(const value_type &value) const {
+      return ImmutableRadixMap(insert(root, KeyOf()(value.first), value,
+                                      /*replace=*/false));
+    }
+    ImmutableRadixMap replace(const value_type &value) const {
+      return ImmutableRadixMap(insert(root, KeyOf()(value.first), value,
+                                      /*replace=*/true));
+    }
+    ImmutableRadixMap remove(const key_type &key) const {
+      return ImmutableRadixMap(remove(root, KeyOf()(key)));
+    }
+
+    iterator begin() const {
+      iterator it(root);
+      it.descendFirst(root);
+      return it;
+    }
+    iterator end() const { return iterator(root); }
+    iterator find(const key_type &key) const {
+      iterator it = lower_bound(key);
+      if (it != end() && it.leaf->key != KeyOf()(key))
+        return end();
+      return it;
+    }
+    iterator lower_bound(const key_type &key) const {
+      return bound(KeyOf()(key), /*strict=*/false);
+    }
+    iterator upper_bound(const key_type &key) const {
+      return bound(KeyOf()(key), /*strict=*/true);
+    }
+  };
+
+  /***/
+
+  /// Bidirectional iterator in key order. Decrementing end() yields the last
+  /// element, decrementing begin() yields end().
+  template<class K, class D, class KeyOf>
+  class ImmutableRadixMap<K,D,KeyOf>::iterator {
+    friend class ImmutableRadixMap<K,D,KeyOf>;
+
+    const Entry *root;
+    /// The nodes on the path to leaf and the position taken in each
+    std::array<std::pair<const Node *, unsigned>, MaxDepth> stack;
+    unsigned depth;
+    const Leaf *leaf;
+
+    explicit iterator(const Entry *_root)
+        : root(_root), depth(0), leaf(nullptr) {}
+
+    void descendFirst(const Entry *e) {
+      while (e && !e->isLeaf) {
+        const Node *n = static_cast<const Node *>(e);
+        stack[depth++] = std::make_pair(n, 0u);
+        e = n->child(0);
+      }
+      leaf = static_cast<const Leaf *>(e);
+    }
+
+    void descendLast(const Entry *e) {
+      while (e && !e->isLeaf) {
+        const Node *n = static_cast<const Node *>(e);
+        unsigned last = n->count() - 1;
+        stack[depth++] = std::make_pair(n, last);
+        e = n->child(last);
+      }
+      leaf = static_cast<const Leaf *>(e);
+    }
+
+    /// Moves past the child at the top of the stack
+    void advance() {
+      for (; depth; --depth) {
+        auto &top = stack[depth - 1];
+        if (top.second + 1 < top.first->count()) {
+          ++top.second;
+          descendFirst(top.first->child(top.second));
+          return;
+        }
+      }
+      leaf = nullptr;
+    }
+
+    /// Moves before the child at the top of the stack
+    void retreat() {
+      for (; depth; --depth) {
+        auto &top = stack[depth - 1];
+        if (top.second > 0) {
+          --top.second;
+          descendLast(top.first->child(top.second));
+          return;
+        }
+      }
+      leaf = nullptr;
+    }
+
+  public:
+    iterator() : root(nullptr), depth(0), leaf(nullptr) {}
+
+    const value_type &operator*() const {
+      assert(leaf && "dereferencing end()");
+      return leaf->value;
+    }
+    const value_type *operator->() const { return &**this; }
+
+    bool operator==(const iterator &b) const { return leaf == b.leaf; }
+    bool operator!=(const iterator &b) const { return leaf != b.leaf; }
+
+    iterator &operator++() {
+      assert(leaf && "incrementing end()");
+      advance();
+      return *this;
+    }
+    iterator &operator--() {
+      if (leaf) {
+        retreat();
+      } else {
+        depth = 0;
+        descendLast(root);
+      }
+      return *this;
+    }
+  };
+
+  template<class K, class D, class KeyOf>
+  typename ImmutableRadixMap<K,D,KeyOf>::iterator
+  ImmutableRadixMap<K,D,KeyOf>::bound(uint64_t key, bool strict) const {
+    iterator it(root);
+    const Entry *e = root;
+    while (e) {
+      if (e->isLeaf) {
+        const Leaf *l = static_cast<const Leaf *>(e);
+        it.leaf = l;
+        if (l->key < key || (strict && l->key == key))
+          it.advance();
+        return it;
+      }
+
+      const Node *n = static_cast<const Node *>(e);
+      if (key < n->low()) {
+        it.descendFirst(n);
+        return it;
+      }
+      if (key > n->high()) {
+        // Everything below n is smaller, continue after it
+        it.advance();
+        return it;
+      }
+
+      unsigned idx = n->index(key);
+      unsigned pos = n->position(idx);
+      if (n->bitmap & (1u << idx)) {
+        it.stack[it.depth++] = std::make_pair(n, pos);
+        e = n->child(pos);
+      } else if (pos < n->count()) {
+        // The next child holds the first larger key
+        it.stack[it.depth++] = std::make_pair(n, pos);
+        it.descendFirst(n->child(pos));
+        return it;
+      } else {
+        it.stack[it.depth++] = std::make_pair(n, pos - 1);
+        it.advance();
+        return it;
+      }
+    }
+    return it;
+  }
+}
+
+#endif /* KLEE_IMMUTABLERADIXMAP_H */
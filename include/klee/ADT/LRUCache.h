@@ -0,0 +1,82 @@
+//===-- LRUCache.h ----------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_LRUCACHE_H
+#define KLEE_LRUCACHE_H
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace klee {
+  /// Map holding at most a fixed number of entries. Once full, inserting
+  /// evicts the least recently used entry, where both lookups and inserts
+  /// count as uses. A cache of capacity 0 holds nothing.
+  template<class Key, class Value, class Hash = std::hash<Key>,
+           class Equal = std::equal_to<Key> >
+  class LRUCache {
+  private:
+    typedef std::list<std::pair<Key, Value> > entries_ty;
+
+    /// Entries ordered from most to least recently used
+    entries_ty entries;
+    std::unordered_map<Key, typename entries_ty::iterator, Hash, Equal> index;
+    std::size_t capacity;
+
+  public:
+    typedef typename entries_ty::const_iterator iterator;
+
+    explicit LRUCache(std::size_t _capacity) : capacity(_capacity) {}
+    LRUCache(const LRUCache &) = delete;
+    LRUCache &operator=(const LRUCache &) = delete;
+
+    std::size_t size() const { return entries.size(); }
+    std::size_t getCapacity() const { return capacity; }
+
+    iterator begin() const { return entries.begin(); }
+    iterator end() const { return entries.end(); }
+
+    /// Returns the value for key, or null if it is not cached. The pointer
+    /// is valid until the next insert or clear.
+    Value *find(const Key &key) {
+      auto it = index.find(key);
+      if (it == index.end())
+        return nullptr;
+      entries.splice(entries.begin(), entries, it->second);
+      return &it->second->second;
+    }
+
+    /// Adds (or replaces) the value for key.
+    void insert(const Key &key, const Value &value) {
+      auto it = index.find(key);
+      if (it != index.end()) {
+        it->second->second = value;
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+      }
+      if (capacity == 0)
+        return;
+      if (entries.size() == capacity) {
+        index.erase(entries.back().first);
+        entries.pop_back();
+      }
+      entries.emplace_front(key, value);
+      index.emplace(key, entries.begin());
+    }
+
+    void clear() {
+      index.clear();
+      entries.clear();
+    }
+  };
+}
+
+#endif /* KLEE_LRUCACHE_H */
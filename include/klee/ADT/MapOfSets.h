@@ -11,9 +11,12 @@
 #define KLEE_MAPOFSETS_H
 
 #include <cassert>
-#include <vector>
-#include <set>
+#include <cstdint>
+#include <functional>
 #include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
 
 // This should really be broken down into TreeOfSets on top of which
 // SetOfSets and MapOfSets are easily implemeted. It should also be
@@ -25,8 +28,14 @@
 namespace klee {
 
   /** This implements the UBTree data structure (see Hoffmann and
-      Koehler, "A New Method to Index and Query Sets", IJCAI 1999) */
-  template<class K, class V>
+      Koehler, "A New Method to Index and Query Sets", IJCAI 1999).
+
+      Searching the tree for supersets has to walk every branch with smaller
+      elements, which grows with the number of sets. Superset searches
+      therefore use an inverted index from elements to the sets containing
+      them instead, and subset searches skip subtrees using a 64-bit Bloom
+      signature of the elements every set below a node shares. */
+  template<class K, class V, class Hash = std::hash<K> >
   class MapOfSets {
   public:
     class iterator;
@@ -56,7 +65,24 @@ namespace klee {
   private:
     class Node;
 
+    /// A set as a sorted vector together with the signature of each of its
+    /// suffixes, suffixes[i] covering the elements from i onwards
+    struct SearchKey {
+      std::vector<K> elements;
+      std::vector<uint64_t> suffixes;
+
+      explicit SearchKey(const std::set<K> &set);
+    };
+
     Node root;
+    /// The end nodes of all sets containing an element
+    std::unordered_map<K, std::vector<Node *>, Hash> containing;
+
+    static uint64_t getSignature(const K &element) {
+      // Spread the hash before picking one of the 64 bits
+      uint64_t h = static_cast<uint64_t>(Hash()(element));
+      return 1ULL << ((h * 0x9E3779B97F4A7C15ULL) >> 58);
+    }
 
     template<class Iterator, class Vector>
     void findSubsets(Node *n, 
@@ -71,23 +97,19 @@ namespace klee {
                        Iterator end,
                        Vector &resultsOut);
     template<class Predicate>
-    V *findSuperset(Node *n, 
-                    typename std::set<K>::iterator begin, 
-                    typename std::set<K>::iterator end,
-                    const Predicate &p);
+    V *findAny(Node *n, const Predicate &p);
+    static bool includes(Node *n, const std::set<K> &set);
     template<class Predicate>
-    V *findSubset(Node *n, 
-                  typename std::set<K>::iterator begin, 
-                  typename std::set<K>::iterator end,
+    V *findSubset(Node *n, const SearchKey &key, std::size_t i,
                   const Predicate &p);
   };
 
   /***/
 
-  template<class K, class V>
-  class MapOfSets<K,V>::Node {
-    friend class MapOfSets<K,V>;
-    friend class MapOfSets<K,V>::iterator;
+  template<class K, class V, class Hash>
+  class MapOfSets<K,V,Hash>::Node {
+    friend class MapOfSets<K,V,Hash>;
+    friend class MapOfSets<K,V,Hash>::iterator;
 
   public:
     typedef std::map<K, Node> children_ty;
@@ -97,15 +119,23 @@ namespace klee {
   private:
     bool isEndOfSet;
     std::map<K, Node> children;
+    /// The parent of this node and the element leading to it from there
+    Node *parent;
+    const K *element;
+    /// Intersection of the signatures of the elements which the sets passing
+    /// through this node have below it
+    uint64_t allSignature;
     
   public:
-    Node() : value(), isEndOfSet(false) {}
+    Node()
+        : value(), isEndOfSet(false), parent(0), element(0),
+          allSignature(~0ULL) {}
   };
   
-  template<class K, class V>
-  class MapOfSets<K,V>::iterator {
+  template<class K, class V, class Hash>
+  class MapOfSets<K,V,Hash>::iterator {
     typedef std::vector< typename std::map<K, Node>::iterator > stack_ty;
-    friend class MapOfSets<K,V>;
+    friend class MapOfSets<K,V,Hash>;
   private:
     Node *root;
     bool onEntry;
@@ -181,21 +211,39 @@ namespace klee {
 
   /***/
 
-  template<class K, class V>
-  MapOfSets<K,V>::MapOfSets() {}  
+  template<class K, class V, class Hash>
+  MapOfSets<K,V,Hash>::MapOfSets() {}  
+
+  template<class K, class V, class Hash>
+  MapOfSets<K,V,Hash>::SearchKey::SearchKey(const std::set<K> &set)
+      : elements(set.begin(), set.end()), suffixes(set.size() + 1, 0) {
+    for (std::size_t i = elements.size(); i != 0; --i)
+      suffixes[i - 1] = suffixes[i] | getSignature(elements[i - 1]);
+  }
 
-  template<class K, class V>
-  void MapOfSets<K,V>::insert(const std::set<K> &set, const V &value) {
+  template<class K, class V, class Hash>
+  void MapOfSets<K,V,Hash>::insert(const std::set<K> &set, const V &value) {
+    SearchKey key(set);
     Node *n = &root;
-    for (auto const& element : set) {
-      n = &n->children.insert(std::make_pair(element, Node())).first->second;
+    for (std::size_t i = 0, e = key.elements.size(); i != e; ++i) {
+      n->allSignature &= key.suffixes[i];
+      auto it = n->children.insert(std::make_pair(key.elements[i], Node()))
+                    .first;
+      it->second.parent = n;
+      it->second.element = &it->first;
+      n = &it->second;
     }
+    if (!n->isEndOfSet) {
+      for (auto const &element : set)
+        containing[element].push_back(n);
+    }
+    n->allSignature = 0;
     n->isEndOfSet = true;
     n->value = value;
   }
 
-  template<class K, class V>
-  V *MapOfSets<K,V>::lookup(const std::set<K> &set) {
+  template<class K, class V, class Hash>
+  V *MapOfSets<K,V,Hash>::lookup(const std::set<K> &set) {
     Node *n = &root;
     for (typename std::set<K>::const_iterator it = set.begin(), ie = set.end();
          it != ie; ++it) {
@@ -213,17 +261,17 @@ namespace klee {
     }
   }
 
-  template<class K, class V>
-  typename MapOfSets<K,V>::iterator 
-  MapOfSets<K,V>::begin() { return iterator(&root); }
+  template<class K, class V, class Hash>
+  typename MapOfSets<K,V,Hash>::iterator 
+  MapOfSets<K,V,Hash>::begin() { return iterator(&root); }
   
-  template<class K, class V>
-  typename MapOfSets<K,V>::iterator 
-  MapOfSets<K,V>::end() { return iterator(); }
+  template<class K, class V, class Hash>
+  typename MapOfSets<K,V,Hash>::iterator 
+  MapOfSets<K,V,Hash>::end() { return iterator(); }
 
-  template<class K, class V>
+  template<class K, class V, class Hash>
   template<class Iterator, class Vector>
-  void MapOfSets<K,V>::findSubsets(Node *n, 
+  void MapOfSets<K,V,Hash>::findSubsets(Node *n, 
                                   const std::set<K> &accum,
                                   Iterator begin, 
                                   Iterator end,
@@ -244,16 +292,16 @@ namespace klee {
     }
   }
 
-  template<class K, class V>
-  void MapOfSets<K,V>::subsets(const std::set<K> &set,
+  template<class K, class V, class Hash>
+  void MapOfSets<K,V,Hash>::subsets(const std::set<K> &set,
                                std::vector< std::pair<std::set<K>, 
                                                       V> > &resultOut) {
     findSubsets(&root, std::set<K>(), set.begin(), set.end(), resultOut);
   }
 
-  template<class K, class V>
+  template<class K, class V, class Hash>
   template<class Iterator, class Vector>
-  void MapOfSets<K,V>::findSupersets(Node *n, 
+  void MapOfSets<K,V,Hash>::findSupersets(Node *n, 
                                      const std::set<K> &accum,
                                      Iterator begin, 
                                      Iterator end,
@@ -286,97 +334,106 @@ namespace klee {
     }
   }
 
-  template<class K, class V>
-  void MapOfSets<K,V>::supersets(const std::set<K> &set,
+  template<class K, class V, class Hash>
+  void MapOfSets<K,V,Hash>::supersets(const std::set<K> &set,
                                std::vector< std::pair<std::set<K>, V> > &resultOut) {
     findSupersets(&root, std::set<K>(), set.begin(), set.end(), resultOut);
   }
 
-  template<class K, class V>
+  template<class K, class V, class Hash>
   template<class Predicate>
-  V *MapOfSets<K,V>::findSubset(Node *n, 
-                                typename std::set<K>::iterator begin, 
-                                typename std::set<K>::iterator end,
-                                const Predicate &p) {   
-    if (n->isEndOfSet && p(n->value)) {
+  V *MapOfSets<K,V,Hash>::findSubset(Node *n, const SearchKey &key,
+                                     std::size_t i, const Predicate &p) {
+    if (n->isEndOfSet && p(n->value))
       return &n->value;
-    } else if (begin==end) {
+    // Every set below n has an element outside of the key
+    if (i == key.elements.size() || (n->allSignature & ~key.suffixes[i]))
       return 0;
-    } else {
-      typename Node::children_ty::iterator kend = n->children.end();
-      typename Node::children_ty::iterator 
-        kbegin = n->children.lower_bound(*begin);
-      typename std::set<K>::iterator it = begin;
-      if (kbegin==kend)
-        return 0;
-      for (;;) { // kbegin!=kend && *it <= kbegin->first
-        while (*it < kbegin->first) {
-          ++it;
-          if (it==end)
-            return 0;
-        }
-        if (*it == kbegin->first) {
-          ++it;
-          V *res = findSubset(&kbegin->second, it, end, p);
-          if (res || it==end)
-            return res;
-        }
-        while (kbegin->first < *it) {
-          ++kbegin;
-          if (kbegin==kend)
-            return 0;
-        }
+
+    typename Node::children_ty::iterator kit =
+        n->children.lower_bound(key.elements[i]);
+    typename Node::children_ty::iterator kend = n->children.end();
+    for (std::size_t e = key.elements.size(); kit != kend && i != e;) {
+      if (key.elements[i] < kit->first) {
+        ++i;
+      } else if (kit->first < key.elements[i]) {
+        kit = n->children.lower_bound(key.elements[i]);
+      } else {
+        ++i;
+        if (V *res = findSubset(&kit->second, key, i, p))
+          return res;
+        ++kit;
       }
     }
+    return 0;
   }
   
-  template<class K, class V>
+  template<class K, class V, class Hash>
   template<class Predicate>
-  V *MapOfSets<K,V>::findSuperset(Node *n, 
-                                  typename std::set<K>::iterator begin, 
-                                  typename std::set<K>::iterator end,
-                                  const Predicate &p) {   
-    if (begin==end) {
-      if (n->isEndOfSet && p(n->value))
-        return &n->value;
-      for (typename Node::children_ty::iterator it = n->children.begin(),
-             ie = n->children.end(); it != ie; ++it) {
-        V *res = findSuperset(&it->second, begin, end, p);
-        if (res) return res;
-      }
-    } else {
-      typename Node::children_ty::iterator kmid = 
-        n->children.lower_bound(*begin);
-      for (typename Node::children_ty::iterator it = n->children.begin(),
-             ie = n->children.end(); it != ie; ++it) {
-        V *res = findSuperset(&it->second, begin, end, p);
-        if (res) return res;
-      }
-      if (kmid!=n->children.end() && *begin==kmid->first) {
-        V *res = findSuperset(&kmid->second, ++begin, end, p);
-        if (res) return res;
-      }
+  V *MapOfSets<K,V,Hash>::findAny(Node *n, const Predicate &p) {
+    if (n->isEndOfSet && p(n->value))
+      return &n->value;
+    for (typename Node::children_ty::iterator it = n->children.begin(),
+           ie = n->children.end(); it != ie; ++it) {
+      V *res = findAny(&it->second, p);
+      if (res) return res;
     }
     return 0;
   }
 
-  template<class K, class V>
+  template<class K, class V, class Hash>
+  bool MapOfSets<K,V,Hash>::includes(Node *n, const std::set<K> &set) {
+    // Walk up from the end of the stored set, seeing its elements in
+    // decreasing order
+    typename std::set<K>::const_reverse_iterator it = set.rbegin(),
+                                                 ie = set.rend();
+    for (; n->parent && it != ie; n = n->parent) {
+      if (*n->element < *it)
+        return false;
+      if (!(*it < *n->element))
+        ++it;
+    }
+    return it == ie;
+  }
+
+  template<class K, class V, class Hash>
   template<class Predicate>
-  V *MapOfSets<K,V>::findSuperset(const std::set<K> &set, const Predicate &p) {    
-    return findSuperset(&root, set.begin(), set.end(), p);
+  V *MapOfSets<K,V,Hash>::findSuperset(const std::set<K> &set,
+                                       const Predicate &p) {
+    if (set.empty())
+      return findAny(&root, p);
+
+    // Only sets containing the rarest element of the key are candidates
+    std::vector<Node *> *candidates = 0;
+    for (auto const &element : set) {
+      auto it = containing.find(element);
+      if (it == containing.end())
+        return 0;
+      if (!candidates || it->second.size() < candidates->size())
+        candidates = &it->second;
+    }
+
+    for (Node *n : *candidates) {
+      if (includes(n, set) && p(n->value))
+        return &n->value;
+    }
+    return 0;
   }
 
-  template<class K, class V>
+  template<class K, class V, class Hash>
   template<class Predicate>
-  V *MapOfSets<K,V>::findSubset(const std::set<K> &set, const Predicate &p) {    
-    return findSubset(&root, set.begin(), set.end(), p);
+  V *MapOfSets<K,V,Hash>::findSubset(const std::set<K> &set,
+                                     const Predicate &p) {
+    return findSubset(&root, SearchKey(set), 0, p);
   }
 
-  template<class K, class V>
-  void MapOfSets<K,V>::clear() {
+  template<class K, class V, class Hash>
+  void MapOfSets<K,V,Hash>::clear() {
     root.isEndOfSet = false;
     root.value = V();
     root.children.clear();
+    root.allSignature = ~0ULL;
+    containing.clear();
   }
 
 }
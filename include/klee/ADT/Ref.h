@@ -24,16 +24,28 @@
  * }
  * @endcode
  *
+ * ## Thread safety:
+ *
+ * By default, reference counts are plain integers and ref<>-managed objects
+ * must not be shared between threads. Configuring KLEE with
+ * `-DENABLE_ATOMIC_REFCOUNT=ON` makes the counter atomic, so that objects
+ * can be referenced and released concurrently.
+ *
  */
 
 #ifndef KLEE_REF_H
 #define KLEE_REF_H
 
+#include "klee/Config/config.h"
 #include "klee/Support/Casting.h"
 
 #include <cassert>
 #include <iosfwd> // FIXME: Remove this when LLVM 4.0 support is removed!!!
 
+#ifdef ENABLE_ATOMIC_REFCOUNT
+#include <atomic>
+#endif
+
 namespace llvm {
   class raw_ostream;
 } // namespace llvm
@@ -49,7 +61,36 @@ class ReferenceCounter {
   friend class ref;
 
   /// Count how often the object has been referenced.
+#ifdef ENABLE_ATOMIC_REFCOUNT
+  std::atomic<unsigned> refCount{0};
+#else
   unsigned refCount = 0;
+#endif
+
+  void increment() {
+#ifdef ENABLE_ATOMIC_REFCOUNT
+    // Taking a new reference requires an existing one, so no ordering with
+    // respect to other memory operations is needed.
+    refCount.fetch_add(1, std::memory_order_relaxed);
+#else
+    ++refCount;
+#endif
+  }
+
+  /// Drops a reference.
+  /// \return true if this was the last reference to the object
+  bool decrement() {
+#ifdef ENABLE_ATOMIC_REFCOUNT
+    // Release our writes to the object, and acquire all other threads'
+    // writes before the last owner deletes it.
+    if (refCount.fetch_sub(1, std::memory_order_release) != 1)
+      return false;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+#else
+    return --refCount == 0;
+#endif
+  }
 
 public:
   ReferenceCounter() = default;
@@ -91,11 +132,11 @@ public:
 private:
   void inc() const {
     if (ptr)
-      ++ptr->_refCount.refCount;
+      ptr->_refCount.increment();
   }
 
   void dec() const {
-    if (ptr && --ptr->_refCount.refCount == 0)
+    if (ptr && ptr->_refCount.decrement())
       delete ptr;
   }
 
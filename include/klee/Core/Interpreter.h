@@ -127,6 +127,13 @@ public:
   // a user specified path. use null to reset.
   virtual void setReplayPath(const std::vector<bool> *path) = 0;
 
+  // supply a list of branch decisions that every state follows on its
+  // first symbolic forks; afterwards exploration continues normally.
+  // Paths are only reported if they consumed the prefix or if all of its
+  // unconsumed decisions are false, so that runs with all prefixes of one
+  // length explore disjoint parts of the tree. use null to reset.
+  virtual void setPathPrefix(const std::vector<bool> *prefix) = 0;
+
   // supply a set of symbolic bindings that will be used as "seeds"
   // for the search. use null to reset.
   virtual void useSeeds(const std::vector<struct KTest *> *seeds) = 0;
@@ -13,6 +13,9 @@
 #include "klee/Expr/Expr.h"
 #include "klee/Expr/ArrayExprHash.h" // For klee::ArrayHashFn
 
+#ifdef ENABLE_ATOMIC_REFCOUNT
+#include <mutex>
+#endif
 #include <string>
 #include <unordered_set>
 #include <vector>
@@ -66,6 +69,9 @@ private:
   ArrayHashMap cachedSymbolicArrays;
   typedef std::vector<const Array *> ArrayPtrVec;
   ArrayPtrVec concreteArrays;
+#ifdef ENABLE_ATOMIC_REFCOUNT
+  std::mutex lock;
+#endif
 };
 }
 
@@ -43,6 +43,19 @@ struct UpdateNodeCmpFn {
   }
 };  
 
+/// Hashes update nodes by identity, like UpdateNodeHashFn, but keeps the
+/// nodes alive so that their addresses cannot be reused
+struct UpdateNodeRefHashFn {
+  unsigned operator()(const ref<UpdateNode> &un) const { return un->hash(); }
+};
+
+struct UpdateNodeRefCmpFn {
+  bool operator()(const ref<UpdateNode> &un1,
+                  const ref<UpdateNode> &un2) const {
+    return un1.get() == un2.get();
+  }
+};
+
 template<class T>
 class ArrayExprHash {  
 public:
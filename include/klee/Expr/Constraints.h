@@ -10,38 +10,184 @@
 #ifndef KLEE_CONSTRAINTS_H
 #define KLEE_CONSTRAINTS_H
 
+#include "klee/ADT/ImmutableMap.h"
+#include "klee/ADT/ImmutableSet.h"
 #include "klee/Expr/Expr.h"
 
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
 namespace klee {
 
 /// Resembles a set of constraints that can be passed around
 ///
+/// Constraints are stored in fixed-size chunks, each linked to the chunk
+/// before it. Copies of a set share all chunks, so copying is O(1). A set
+/// appends to its last chunk in place, unless a copy has already appended
+/// to it, in which case that chunk is copied first.
 class ConstraintSet {
   friend class ConstraintManager;
 
+  struct Chunk {
+    static constexpr unsigned Size = 16;
+
+    /// @brief Required by klee::ref-managed objects
+    class ReferenceCounter _refCount;
+
+    const ref<Chunk> parent;
+    /// Number of slots filled by any set sharing this chunk
+    unsigned used = 0;
+    ref<Expr> constraints[Size];
+
+    explicit Chunk(const ref<Chunk> &_parent) : parent(_parent) {}
+  };
+
+  /// Partition of the first `size` constraints into independent factors,
+  /// i.e. the connected components of constraints that (transitively)
+  /// access the same array elements. Partitions are never modified once
+  /// shared; extending one creates a new partition that shares the maps.
+  struct Partition {
+    /// @brief Required by klee::ref-managed objects
+    class ReferenceCounter _refCount;
+
+    typedef std::pair<const Array *, unsigned> element_ty;
+
+    std::size_t size = 0;
+    /// Maps each constraint to its factor, which is identified by one of
+    /// its constraints
+    ImmutableMap<std::size_t, std::size_t> factorOf;
+    /// Maps each factor to the constraints it contains
+    ImmutableMap<std::size_t, ImmutableSet<std::size_t>> members;
+    /// Maps symbolically accessed arrays to a constraint accessing them
+    ImmutableMap<const Array *, std::size_t> wholeObjects;
+    /// Maps concretely accessed elements of all other arrays to a
+    /// constraint accessing them
+    ImmutableMap<element_ty, std::size_t> elements;
+  };
+
 public:
   using constraints_ty = std::vector<ref<Expr>>;
-  using iterator = constraints_ty::iterator;
-  using const_iterator = constraints_ty::const_iterator;
 
-  using constraint_iterator = const_iterator;
+  class constraint_iterator {
+    friend class ConstraintSet;
+
+    const Chunk *const *chunks;
+    std::size_t index;
+
+    constraint_iterator(const Chunk *const *_chunks, std::size_t _index)
+        : chunks(_chunks), index(_index) {}
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = ref<Expr>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const ref<Expr> *;
+    using reference = const ref<Expr> &;
+
+    constraint_iterator() : chunks(nullptr), index(0) {}
+
+    reference operator*() const {
+      return chunks[index / Chunk::Size]->constraints[index % Chunk::Size];
+    }
+    pointer operator->() const { return &**this; }
+
+    constraint_iterator &operator++() {
+      ++index;
+      return *this;
+    }
+    constraint_iterator operator++(int) {
+      constraint_iterator old(*this);
+      ++index;
+      return old;
+    }
+
+    bool operator==(const constraint_iterator &b) const {
+      return index == b.index;
+    }
+    bool operator!=(const constraint_iterator &b) const {
+      return index != b.index;
+    }
+  };
+
+  using iterator = constraint_iterator;
+  using const_iterator = constraint_iterator;
 
   bool empty() const;
   constraint_iterator begin() const;
   constraint_iterator end() const;
   size_t size() const noexcept;
 
-  explicit ConstraintSet(constraints_ty cs) : constraints(std::move(cs)) {}
+  /// Hash of the constraints in order, maintained incrementally
+  unsigned hash() const { return hashValue; }
+
+  explicit ConstraintSet(const constraints_ty &cs);
   ConstraintSet() = default;
+  ConstraintSet(const ConstraintSet &b)
+      : last(b.last), count(b.count), hashValue(b.hashValue),
+        partition(b.partition) {}
+  ConstraintSet(ConstraintSet &&b)
+      : last(std::move(b.last)), count(b.count), hashValue(b.hashValue),
+        chunks(std::move(b.chunks)), partition(std::move(b.partition)) {
+    b.count = 0;
+    b.hashValue = 0;
+    b.chunks.clear();
+  }
+
+  ConstraintSet &operator=(const ConstraintSet &b) {
+    last = b.last;
+    count = b.count;
+    hashValue = b.hashValue;
+    chunks.clear();
+    partition = b.partition;
+    return *this;
+  }
+  ConstraintSet &operator=(ConstraintSet &&b) {
+    std::swap(last, b.last);
+    std::swap(count, b.count);
+    std::swap(hashValue, b.hashValue);
+    std::swap(chunks, b.chunks);
+    std::swap(partition, b.partition);
+    return *this;
+  }
 
   void push_back(const ref<Expr> &e);
 
-  bool operator==(const ConstraintSet &b) const {
-    return constraints == b.constraints;
-  }
+  /// Appends all constraints that access (transitively) the same array
+  /// elements as expr to result, in the order they were added.
+  void getIndependentConstraints(const ref<Expr> &expr,
+                                 std::vector<ref<Expr>> &result) const;
+
+  /// Partitions the constraints into independent factors. Factors and the
+  /// constraints within them are in the order the constraints were added.
+  void
+  getIndependentFactors(std::vector<std::vector<ref<Expr>>> &factors) const;
+
+  bool operator==(const ConstraintSet &b) const;
 
 private:
-  constraints_ty constraints;
+  ref<Chunk> last;
+  std::size_t count = 0;
+  unsigned hashValue = 0;
+
+  /// All chunks from the first to the last one, built on demand for
+  /// iteration and not shared with copies.
+  mutable std::vector<const Chunk *> chunks;
+
+  /// Partition of (a prefix of) the constraints into independent factors,
+  /// extended on demand and shared with copies.
+  mutable ref<Partition> partition;
+
+  const std::vector<const Chunk *> &getChunks() const;
+  const ref<Expr> &getConstraint(std::size_t index) const;
+  const Partition &getPartition() const;
+
+  /// Adds constraint e with the given index to partition p
+  static void extendPartition(Partition &p, std::size_t index,
+                              const ref<Expr> &e);
+  /// Merges the factors a and b of partition p and returns the result
+  static std::size_t mergeFactors(Partition &p, std::size_t a, std::size_t b);
 };
 
 class ExprVisitor;
@@ -12,6 +12,7 @@
 
 #include "klee/ADT/Bits.h"
 #include "klee/ADT/Ref.h"
+#include "klee/Expr/ExprAllocator.h"
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/DenseSet.h"
@@ -90,7 +91,11 @@ Todo: Shouldn't bool \c Xor just be written as not equal?
 
 class Expr {
 public:
+#ifdef ENABLE_ATOMIC_REFCOUNT
+  static std::atomic<unsigned> count;
+#else
   static unsigned count;
+#endif
   static const unsigned MAGIC_HASH_CONSTANT = 39;
 
   /// The type of an expression is simply its width, in bits. 
@@ -205,7 +210,16 @@ protected:
 
 public:
   Expr() { Expr::count++; }
-  virtual ~Expr() { Expr::count--; } 
+  virtual ~Expr();
+
+#ifdef ENABLE_EXPR_POOL_ALLOCATOR
+  static void *operator new(std::size_t size) {
+    return ExprAllocator::allocate(size);
+  }
+  static void operator delete(void *p, std::size_t size) {
+    ExprAllocator::deallocate(p, size);
+  }
+#endif
 
   virtual Kind getKind() const = 0;
   virtual Width getWidth() const = 0;
@@ -280,6 +294,13 @@ public:
   struct CreateArg;
   static ref<Expr> createFromKind(Kind k, std::vector<CreateArg> args);
 
+  /// Returns the live expression that is structurally equal to \p e if
+  /// expression interning (--use-expr-interning) is enabled, so that equal
+  /// expressions share a single node. Otherwise, or if there is none yet,
+  /// \p e is returned. Called by the alloc() functions of all non-constant
+  /// expressions.
+  static ref<Expr> createCachedExpr(const ref<Expr> &e);
+
   static bool isValidKidWidth(unsigned kid, Width w) { return true; }
   static bool needsResultType() { return false; }
 
@@ -417,7 +438,7 @@ public:
   static ref<Expr> alloc(const ref<Expr> &src) {
     ref<Expr> r(new NotOptimizedExpr(src));
     r->computeHash();
-    return r;
+    return createCachedExpr(r);
   }
   
   static ref<Expr> create(ref<Expr> src);
@@ -464,7 +485,11 @@ public:
 private:
   /// size of this update sequence, including this update
   unsigned size;
-  
+
+  /// size of the update sequence after it was last compacted, see
+  /// UpdateList::extend
+  mutable unsigned compactedSize;
+
 public:
   UpdateNode(const ref<UpdateNode> &_next, const ref<Expr> &_index,
              const ref<Expr> &_value);
@@ -477,6 +502,15 @@ public:
   UpdateNode() = delete;
   ~UpdateNode() = default;
 
+#ifdef ENABLE_EXPR_POOL_ALLOCATOR
+  static void *operator new(std::size_t size) {
+    return ExprAllocator::allocate(size);
+  }
+  static void operator delete(void *p, std::size_t size) {
+    ExprAllocator::deallocate(p, size);
+  }
+#endif
+
   unsigned computeHash();
 };
 
@@ -555,10 +589,19 @@ public:
   /// size of this update list
   unsigned getSize() const { return head ? head->getSize() : 0; }
 
+  /// Add a write of value to index. Writes to concrete indices that are
+  /// overwritten by later writes to the same index are dropped, either
+  /// immediately if they are the most recent write or when the list has
+  /// doubled in size since it was last compacted.
   void extend(const ref<Expr> &index, const ref<Expr> &value);
 
   int compare(const UpdateList &b) const;
   unsigned hash() const;
+
+private:
+  /// Drop the writes to concrete indices that are overwritten by later
+  /// writes to the same index
+  void compact();
 };
 
 /// Class representing a one byte read from an array. 
@@ -575,7 +618,7 @@ public:
   static ref<Expr> alloc(const UpdateList &updates, const ref<Expr> &index) {
     ref<Expr> r(new ReadExpr(updates, index));
     r->computeHash();
-    return r;
+    return createCachedExpr(r);
   }
   
   static ref<Expr> create(const UpdateList &updates, ref<Expr> i);
@@ -620,7 +663,7 @@ public:
                          const ref<Expr> &f) {
     ref<Expr> r(new SelectExpr(c, t, f));
     r->computeHash();
-    return r;
+    return createCachedExpr(r);
   }
   
   static ref<Expr> create(ref<Expr> c, ref<Expr> t, ref<Expr> f);
@@ -683,7 +726,7 @@ public:
   static ref<Expr> alloc(const ref<Expr> &l, const ref<Expr> &r) {
     ref<Expr> c(new ConcatExpr(l, r));
     c->computeHash();
-    return c;
+    return createCachedExpr(c);
   }
   
   static ref<Expr> create(const ref<Expr> &l, const ref<Expr> &r);
@@ -750,7 +793,7 @@ public:
   static ref<Expr> alloc(const ref<Expr> &e, unsigned o, Width w) {
     ref<Expr> r(new ExtractExpr(e, o, w));
     r->computeHash();
-    return r;
+    return createCachedExpr(r);
   }
   
   /// Creates an ExtractExpr with the given bit offset and width
@@ -801,7 +844,7 @@ public:
   static ref<Expr> alloc(const ref<Expr> &e) {
     ref<Expr> r(new NotExpr(e));
     r->computeHash();
-    return r;
+    return createCachedExpr(r);
   }
   
   static ref<Expr> create(const ref<Expr> &e);
@@ -878,7 +921,7 @@ public:                                                          \
     static ref<Expr> alloc(const ref<Expr> &e, Width w) {        \
       ref<Expr> r(new _class_kind ## Expr(e, w));                \
       r->computeHash();                                          \
-      return r;                                                  \
+      return createCachedExpr(r);                                \
     }                                                            \
     static ref<Expr> create(const ref<Expr> &e, Width w);        \
     Kind getKind() const { return _class_kind; }                 \
@@ -911,7 +954,7 @@ CAST_EXPR_CLASS(ZExt)
     static ref<Expr> alloc(const ref<Expr> &l, const ref<Expr> &r) {           \
       ref<Expr> res(new _class_kind##Expr(l, r));                              \
       res->computeHash();                                                      \
-      return res;                                                              \
+      return createCachedExpr(res);                                            \
     }                                                                          \
     static ref<Expr> create(const ref<Expr> &l, const ref<Expr> &r);           \
     Width getWidth() const { return left->getWidth(); }                        \
@@ -960,7 +1003,7 @@ ARITHMETIC_EXPR_CLASS(AShr)
     static ref<Expr> alloc(const ref<Expr> &l, const ref<Expr> &r) {           \
       ref<Expr> res(new _class_kind##Expr(l, r));                              \
       res->computeHash();                                                      \
-      return res;                                                              \
+      return createCachedExpr(res);                                            \
     }                                                                          \
     static ref<Expr> create(const ref<Expr> &l, const ref<Expr> &r);           \
     Kind getKind() const { return _class_kind; }                               \
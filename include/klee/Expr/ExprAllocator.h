@@ -0,0 +1,47 @@
+//===-- ExprAllocator.h -----------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_EXPRALLOCATOR_H
+#define KLEE_EXPRALLOCATOR_H
+
+#include <cstddef>
+
+namespace klee {
+
+/// Size-class pool allocator used for Expr and UpdateNode objects when KLEE
+/// is configured with ENABLE_EXPR_POOL_ALLOCATOR.
+///
+/// Requests are rounded up to a multiple of \ref Granularity and served from
+/// a free list per size class, which is refilled from large chunks obtained
+/// from malloc. Memory is never returned to malloc, but freed objects are
+/// reused by later allocations of the same size class. Memory usage measured
+/// through malloc therefore has to discount \ref getFreeBytes. Requests larger than
+/// \ref MaxPooledSize are forwarded to ::operator new.
+///
+/// With ENABLE_ATOMIC_REFCOUNT each thread allocates from its own pools.
+class ExprAllocator {
+public:
+  static constexpr std::size_t Granularity = 8;
+  static constexpr std::size_t MaxPooledSize = 256;
+
+  static void *allocate(std::size_t size);
+  static void deallocate(void *p, std::size_t size);
+
+  /// Returns the number of bytes allocated to live objects.
+  static std::size_t getAllocatedBytes();
+
+  /// Returns the number of bytes obtained from malloc that are not allocated
+  /// to live objects: those held in free lists for reuse and the unused
+  /// parts of chunks.
+  static std::size_t getFreeBytes();
+};
+
+} // namespace klee
+
+#endif /* KLEE_EXPRALLOCATOR_H */
@@ -125,10 +125,13 @@ T ExprRangeEvaluator<T>::evaluate(const ref<Expr> &e) {
     const Expr *ep = e.get();
     T res(0);
     for (unsigned i=0; i<ep->getNumKids(); i++)
-      res = res.concat(evaluate(ep->getKid(i)),8);
+      res = res.concat(evaluate(ep->getKid(i)), ep->getKid(i)->getWidth());
     return res;
   }
 
+  case Expr::ZExt:
+    return evaluate(cast<CastExpr>(e)->src);
+
     // Arithmetic
 
   case Expr::Add: {
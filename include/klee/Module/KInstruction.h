@@ -48,6 +48,17 @@ namespace klee {
 
   };
 
+  struct KBranchInstruction : KInstruction {
+    /// successorEntries - For each successor of the branch, the index of its
+    /// first instruction in the function.
+    unsigned successorEntries[2];
+
+    /// incomingBBIndices - For each successor of the branch, the index of
+    /// the branch's block among the incoming blocks of the successor's PHI
+    /// nodes (if any).
+    unsigned incomingBBIndices[2];
+  };
+
   struct KGEPInstruction : KInstruction {
     /// indices - The list of variable sized adjustments to add to the pointer
     /// operand to execute the instruction. The first element is the operand
@@ -14,6 +14,7 @@
 #include "klee/System/Time.h"
 #include "klee/Solver/SolverCmdLine.h"
 
+#include <utility>
 #include <vector>
 
 namespace klee {
@@ -150,6 +151,21 @@ namespace klee {
     /// \return True on success.
     bool mayBeTrue(const Query&, bool &result);
 
+    /// mayBeTrue - Determine for each of the given expressions if there is a
+    /// valid assignment for the given constraints in which it evaluates to
+    /// true.
+    ///
+    /// This is equivalent to calling mayBeTrue for each expression, but
+    /// allows the solver to share work between them.
+    ///
+    /// \param [out] results - On success, results[i] is true iff exprs[i]
+    /// may be true
+    ///
+    /// \return True on success.
+    bool mayBeTrue(const ConstraintSet &constraints,
+                   const std::vector<ref<Expr> > &exprs,
+                   std::vector<bool> &results);
+
     /// mayBeFalse - Determine if there is a valid assignment for the given
     /// state in which the expression evaluates to false.
     ///
@@ -243,6 +259,15 @@ namespace klee {
   /// \param s - The underlying solver to use.
   Solver *createCexCachingSolver(Solver *s);
 
+  /// createPersistentCachingSolver - Create a solver which caches query
+  /// results in a file, so that they are shared between runs of KLEE. Queries
+  /// are identified independent of the names of the arrays they use. The file
+  /// may be used by several processes at once.
+  ///
+  /// \param s - The underlying solver to use.
+  /// \param path - The cache file, created if it does not exist.
+  Solver *createPersistentCachingSolver(Solver *s, const std::string &path);
+
   /// createFastCexSolver - Create a "fast counterexample solver", which tries
   /// to quickly compute a satisfying assignment for a constraint set using
   /// value propogation and range analysis.
@@ -250,6 +275,14 @@ namespace klee {
   /// \param s - The underlying solver to use.
   Solver *createFastCexSolver(Solver *s);
 
+  /// createBitRangeSolver - Create a solver which tries to decide queries
+  /// using the known bits and value ranges of the array elements, derived
+  /// from the constraints, and to find counterexamples among their extreme
+  /// values.
+  ///
+  /// \param s - The underlying solver to use.
+  Solver *createBitRangeSolver(Solver *s);
+
   /// createIndependentSolver - Create a solver which will eliminate any
   /// unnecessary constraints before propogating the query to the underlying
   /// solver.
@@ -270,6 +303,15 @@ namespace klee {
                                     bool logTimedOut);
 
 
+  /// createPortfolioSolver - Create a solver which runs each query on all of
+  /// the given core solvers concurrently, each in a forked process, and
+  /// returns the first definitive answer.
+  ///
+  /// \param solvers - The core solvers to race, with their backend types.
+  Solver *
+  createPortfolioSolver(const std::vector<std::pair<CoreSolverType, Solver *> >
+                            &solvers);
+
   /// createDummySolver - Create a dummy solver implementation which always
   /// fails.
   Solver *createDummySolver();
@@ -79,6 +79,28 @@ namespace klee {
     /// \return True on success
     virtual bool computeTruth(const Query& query, bool &isValid) = 0;
 
+    /// computeMayBeTrue - Determine for each of the given expressions
+    /// whether it may be true given the constraints.
+    ///
+    /// The expressions are guaranteed to be non-constant and have bool
+    /// type.
+    ///
+    /// SolverImpl provides a default implementation which repeatedly asks
+    /// for an assignment satisfying any of the expressions not known to be
+    /// feasible yet, so that it needs one query per feasible expression plus
+    /// one, instead of one per expression. Clients should override this if
+    /// they can check several expressions against the same constraints more
+    /// efficiently, as the Z3 solver does. Layers in the solver chain should
+    /// forward the batch to the solver they wrap.
+    ///
+    /// \param [out] results - On success, results[i] is true iff
+    /// \f[ \exists X constraints(X) \land exprs[i](X) \f]
+    ///
+    /// \return True on success
+    virtual bool computeMayBeTrue(const ConstraintSet &constraints,
+                                  const std::vector<ref<Expr> > &exprs,
+                                  std::vector<bool> &results);
+
     /// computeValue - Compute a feasible value for the expression.
     ///
     /// The query expression is guaranteed to be non-constant.
@@ -24,8 +24,15 @@ namespace stats {
   extern Statistic queryCexCacheHits;
   extern Statistic queryCexCacheMisses;
   extern Statistic queryConstructs;
+  extern Statistic queryConstructCacheHits;
+  extern Statistic queryConstructCacheMisses;
   extern Statistic queryCounterexamples;
+  extern Statistic queryPersistentCacheHits;
+  extern Statistic queryPersistentCacheMisses;
   extern Statistic queryTime;
+  extern Statistic portfolioWinsSTP;
+  extern Statistic portfolioWinsMetaSMT;
+  extern Statistic portfolioWinsZ3;
   
 #ifdef KLEE_ARRAY_DEBUG
   extern Statistic arrayHashTime;
@@ -13,13 +13,136 @@
 #include "Memory.h"
 #include "TimingSolver.h"
 
+#include "klee/ADT/BitArray.h"
+#include "klee/ADT/Bits.h"
 #include "klee/Expr/Expr.h"
+#include "klee/Expr/ExprRangeEvaluator.h"
 #include "klee/Statistics/TimerStatIncrementer.h"
+#include "klee/Support/IntEvaluation.h"
 
 #include "CoreStats.h"
 
+#include <algorithm>
+
 using namespace klee;
 
+namespace {
+/// Range of unsigned values used to bound pointers. Unlike the ranges of the
+/// fast counterexample solver, it tracks arithmetic as long as it cannot
+/// overflow, as pointers are mostly sums and products of small offsets.
+class AddressRange {
+private:
+  std::uint64_t lo = 1, hi = 0;
+
+  static AddressRange full(unsigned width) {
+    return AddressRange(0, bits64::maxValueOfNBits(width));
+  }
+  /// Smallest value of the form 2^n-1 that is >= value
+  static std::uint64_t fill(std::uint64_t value) {
+    return value ? bits64::maxValueOfNBits(64 - __builtin_clzll(value)) : 0;
+  }
+
+public:
+  AddressRange() = default;
+  AddressRange(const ref<ConstantExpr> &ce)
+      : lo(ce->getLimitedValue()), hi(lo) {}
+  explicit AddressRange(std::uint64_t value) : lo(value), hi(value) {}
+  AddressRange(std::uint64_t _lo, std::uint64_t _hi) : lo(_lo), hi(_hi) {}
+
+  bool isEmpty() const { return lo > hi; }
+  bool isFullRange(unsigned width) const {
+    return lo == 0 && hi == bits64::maxValueOfNBits(width);
+  }
+  std::uint64_t min() const { return lo; }
+  std::uint64_t max() const { return hi; }
+
+  bool mustEqual(std::uint64_t b) const { return lo == hi && lo == b; }
+  bool mustEqual(const AddressRange &b) const {
+    return lo == hi && b.lo == b.hi && lo == b.lo;
+  }
+  bool mayEqual(const AddressRange &b) const {
+    return !isEmpty() && !b.isEmpty() && lo <= b.hi && b.lo <= hi;
+  }
+
+  AddressRange set_union(const AddressRange &b) const {
+    if (isEmpty())
+      return b;
+    if (b.isEmpty())
+      return *this;
+    return AddressRange(std::min(lo, b.lo), std::max(hi, b.hi));
+  }
+
+  AddressRange add(const AddressRange &b, unsigned width) const {
+    std::uint64_t max;
+    if (__builtin_add_overflow(hi, b.hi, &max) ||
+        max > bits64::maxValueOfNBits(width))
+      return full(width);
+    return AddressRange(lo + b.lo, max);
+  }
+  AddressRange sub(const AddressRange &b, unsigned width) const {
+    if (lo < b.hi)
+      return full(width);
+    return AddressRange(lo - b.hi, hi - b.lo);
+  }
+  AddressRange mul(const AddressRange &b, unsigned width) const {
+    std::uint64_t max;
+    if (__builtin_mul_overflow(hi, b.hi, &max) ||
+        max > bits64::maxValueOfNBits(width))
+      return full(width);
+    return AddressRange(lo * b.lo, max);
+  }
+  AddressRange udiv(const AddressRange &b, unsigned width) const {
+    if (b.lo == 0)
+      return full(width);
+    return AddressRange(lo / b.hi, hi / b.lo);
+  }
+  AddressRange urem(const AddressRange &b, unsigned width) const {
+    if (b.lo == 0)
+      return full(width);
+    return AddressRange(0, std::min(hi, b.hi - 1));
+  }
+  AddressRange sdiv(const AddressRange &, unsigned width) const {
+    return full(width);
+  }
+  AddressRange srem(const AddressRange &, unsigned width) const {
+    return full(width);
+  }
+
+  AddressRange binaryAnd(const AddressRange &b) const {
+    return AddressRange(0, std::min(hi, b.hi));
+  }
+  AddressRange binaryOr(const AddressRange &b) const {
+    return AddressRange(std::max(lo, b.lo), fill(hi | b.hi));
+  }
+  AddressRange binaryXor(const AddressRange &b) const {
+    return AddressRange(0, fill(hi | b.hi));
+  }
+  AddressRange concat(const AddressRange &b, unsigned bits) const {
+    if (bits >= 64 || (hi >> (64 - bits)))
+      return full(64);
+    return AddressRange(lo << bits | b.lo, hi << bits | b.hi);
+  }
+
+  std::int64_t minSigned(unsigned bits) const {
+    std::uint64_t smallest = (static_cast<std::uint64_t>(1) << (bits - 1));
+    return hi >= smallest ? ints::sext(smallest, 64, bits) : lo;
+  }
+  std::int64_t maxSigned(unsigned bits) const {
+    std::uint64_t smallest = (static_cast<std::uint64_t>(1) << (bits - 1));
+    if (lo < smallest && hi >= smallest)
+      return smallest - 1;
+    return ints::sext(hi, 64, bits);
+  }
+};
+
+class AddressRangeEvaluator : public ExprRangeEvaluator<AddressRange> {
+protected:
+  AddressRange getInitialReadRange(const Array &array, AddressRange index) {
+    return AddressRange(0, bits64::maxValueOfNBits(array.range));
+  }
+};
+} // namespace
+
 ///
 
 void AddressSpace::bindObject(const MemoryObject *mo, ObjectState *os) {
@@ -104,68 +227,125 @@ bool AddressSpace::resolveOne(ExecutionState &state,
       }
     }
 
-    // didn't work, now we have to search
-       
-    MemoryMap::iterator oi = objects.upper_bound(&hack);
-    MemoryMap::iterator begin = objects.begin();
-    MemoryMap::iterator end = objects.end();
-      
-    MemoryMap::iterator start = oi;
-    while (oi!=begin) {
-      --oi;
-      const auto &mo = oi->first;
-
-      bool mayBeTrue;
-      if (!solver->mayBeTrue(state.constraints,
-                             mo->getBoundsCheckPointer(address), mayBeTrue,
-                             state.queryMetaData))
-        return false;
-      if (mayBeTrue) {
-        result.first = oi->first;
-        result.second = oi->second.get();
+    // didn't work, now we have to search, halving the candidates until a
+    // single object remains. The check of a group also holds for addresses
+    // in the gaps between its objects, so a group that passes may still
+    // turn out empty, and the search then continues with the other half.
+    ResolutionList candidates;
+    getCandidateObjects(address, candidates);
+
+    // Groups still to search, each with whether it has to be checked. The
+    // second half of a group is not checked, it is only searched once the
+    // first half was ruled out.
+    struct Group {
+      std::size_t begin, end;
+      bool check;
+    };
+    std::vector<Group> pending;
+    auto split = [&pending](std::size_t begin, std::size_t end) {
+      std::size_t mid = begin + (end - begin + 1) / 2;
+      if (mid != end)
+        pending.push_back({mid, end, false});
+      pending.push_back({begin, mid, true});
+    };
+    if (!candidates.empty())
+      split(0, candidates.size());
+
+    while (!pending.empty()) {
+      Group group = pending.back();
+      pending.pop_back();
+      bool single = group.end - group.begin == 1;
+      if (group.check || single) {
+        bool mayBeTrue;
+        if (!mayPointInto(state, solver, address, candidates, group.begin,
+                          group.end, mayBeTrue))
+          return false;
+        if (!mayBeTrue)
+          continue;
+      }
+      if (single) {
+        result = candidates[group.begin];
         success = true;
         return true;
-      } else {
-        bool mustBeTrue;
-        if (!solver->mustBeTrue(state.constraints,
-                                UgeExpr::create(address, mo->getBaseExpr()),
-                                mustBeTrue, state.queryMetaData))
-          return false;
-        if (mustBeTrue)
-          break;
       }
+      split(group.begin, group.end);
     }
 
-    // search forwards
-    for (oi=start; oi!=end; ++oi) {
-      const auto &mo = oi->first;
+    success = false;
+    return true;
+  }
+}
 
-      bool mustBeTrue;
-      if (!solver->mustBeTrue(state.constraints,
-                              UltExpr::create(address, mo->getBaseExpr()),
-                              mustBeTrue, state.queryMetaData))
-        return false;
-      if (mustBeTrue) {
-        break;
-      } else {
-        bool mayBeTrue;
+void AddressSpace::getCandidateObjects(ref<Expr> p,
+                                       ResolutionList &candidates) const {
+  AddressRange range = AddressRangeEvaluator().evaluate(p);
+  MemoryObject hack(range.min());
+
+  // Start with the object containing the lowest address, if any
+  MemoryMap::iterator oi = objects.upper_bound(&hack);
+  MemoryMap::iterator begin = objects.begin();
+  MemoryMap::iterator end = objects.end();
+  if (oi != begin) {
+    MemoryMap::iterator prev = oi;
+    --prev;
+    const MemoryObject *mo = prev->first;
+    if (range.min() - mo->address < std::max<uint64_t>(mo->size, 1))
+      oi = prev;
+  }
 
-        if (!solver->mayBeTrue(state.constraints,
-                               mo->getBoundsCheckPointer(address), mayBeTrue,
-                               state.queryMetaData))
-          return false;
-        if (mayBeTrue) {
-          result.first = oi->first;
-          result.second = oi->second.get();
-          success = true;
-          return true;
-        }
-      }
-    }
+  for (; oi != end && oi->first->address <= range.max(); ++oi)
+    candidates.push_back(std::make_pair(oi->first, oi->second.get()));
+}
 
-    success = false;
-    return true;
+bool AddressSpace::mayPointInto(ExecutionState &state, TimingSolver *solver,
+                                ref<Expr> p, const ResolutionList &candidates,
+                                std::size_t begin, std::size_t end,
+                                bool &mayBeTrue) const {
+  assert(begin < end && "no objects to check");
+  ref<Expr> inBounds;
+  if (end - begin == 1) {
+    inBounds = candidates[begin].first->getBoundsCheckPointer(p);
+  } else {
+    // Objects do not overlap, so this is the range spanned by all of them
+    const MemoryObject *first = candidates[begin].first;
+    const MemoryObject *last = candidates[end - 1].first;
+    uint64_t size =
+        last->address - first->address + std::max<uint64_t>(last->size, 1);
+    Expr::Width width = Context::get().getPointerWidth();
+    inBounds = UltExpr::create(SubExpr::create(p, first->getBaseExpr()),
+                               ConstantExpr::create(size, width));
   }
+  return solver->mayBeTrue(state.constraints, inBounds, mayBeTrue,
+                           state.queryMetaData);
+}
+
+int AddressSpace::checkPointerInObjects(
+    ExecutionState &state, TimingSolver *solver, ref<Expr> p,
+    const ResolutionList &candidates, std::size_t begin, std::size_t end,
+    ResolutionList &rl, unsigned maxResolutions,
+    const TimerStatIncrementer &timer, time::Span timeout) const {
+  if (begin == end)
+    return 2;
+  if (timeout && timeout < timer.delta())
+    return 1;
+  if (end - begin == 1)
+    return checkPointerInObject(state, solver, p, candidates[begin], rl,
+                                maxResolutions);
+
+  bool mayBeTrue;
+  if (!mayPointInto(state, solver, p, candidates, begin, end, mayBeTrue))
+    return 1;
+  if (!mayBeTrue)
+    return 2;
+
+  std::size_t mid = begin + (end - begin) / 2;
+  int incomplete = checkPointerInObjects(state, solver, p, candidates, begin,
+                                         mid, rl, maxResolutions, timer,
+                                         timeout);
+  if (incomplete != 2)
+    return incomplete;
+  return checkPointerInObjects(state, solver, p, candidates, mid, end, rl,
+                               maxResolutions, timer, timeout);
 }
 
 int AddressSpace::checkPointerInObject(ExecutionState &state,
@@ -225,67 +405,41 @@ bool AddressSpace::resolve(ExecutionState &state, TimingSolver *solver,
     // see if we need to keep searching up/down, in bad cases?
     // maybe we don't care?
 
-    // XXX we really just need a smart place to start (although
-    // if its a known solution then the code below is guaranteed
-    // to hit the fast path with exactly 2 queries). we could also
-    // just get this by inspection of the expr.
-
+    // Start with the object containing a known solution, if the pointer
+    // is in bounds this hits the fast path with exactly 2 queries.
     ref<ConstantExpr> cex;
     if (!solver->getValue(state.constraints, p, cex, state.queryMetaData))
       return true;
-    uint64_t example = cex->getZExtValue();
-    MemoryObject hack(example);
+    ObjectPair example(nullptr, nullptr);
+    resolveOne(cex, example);
 
-    MemoryMap::iterator oi = objects.upper_bound(&hack);
-    MemoryMap::iterator begin = objects.begin();
-    MemoryMap::iterator end = objects.end();
-
-    MemoryMap::iterator start = oi;
-    // search backwards, start with one minus because this
-    // is the object that p *should* be within, which means we
-    // get write off the end with 4 queries
-    while (oi != begin) {
-      --oi;
-      const MemoryObject *mo = oi->first;
+    ResolutionList candidates;
+    getCandidateObjects(p, candidates);
+    std::size_t split = candidates.size();
+    if (example.first) {
       if (timeout && timeout < timer.delta())
         return true;
 
-      auto op = std::make_pair<>(mo, oi->second.get());
-
-      int incomplete =
-          checkPointerInObject(state, solver, p, op, rl, maxResolutions);
+      int incomplete = checkPointerInObject(state, solver, p, example, rl,
+                                            maxResolutions);
       if (incomplete != 2)
         return incomplete ? true : false;
 
-      bool mustBeTrue;
-      if (!solver->mustBeTrue(state.constraints,
-                              UgeExpr::create(p, mo->getBaseExpr()), mustBeTrue,
-                              state.queryMetaData))
-        return true;
-      if (mustBeTrue)
-        break;
+      split = std::find(candidates.begin(), candidates.end(), example) -
+              candidates.begin();
+      assert(split != candidates.size() && "example outside of the range");
     }
 
-    // search forwards
-    for (oi = start; oi != end; ++oi) {
-      const MemoryObject *mo = oi->first;
-      if (timeout && timeout < timer.delta())
-        return true;
-
-      bool mustBeTrue;
-      if (!solver->mustBeTrue(state.constraints,
-                              UltExpr::create(p, mo->getBaseExpr()), mustBeTrue,
-                              state.queryMetaData))
-        return true;
-      if (mustBeTrue)
-        break;
-      auto op = std::make_pair<>(mo, oi->second.get());
-
-      int incomplete =
-          checkPointerInObject(state, solver, p, op, rl, maxResolutions);
-      if (incomplete != 2)
-        return incomplete ? true : false;
-    }
+    // Search the objects below and above the example
+    int incomplete =
+        checkPointerInObjects(state, solver, p, candidates, 0, split, rl,
+                              maxResolutions, timer, timeout);
+    if (incomplete == 2 && split != candidates.size())
+      incomplete = checkPointerInObjects(state, solver, p, candidates,
+                                         split + 1, candidates.size(), rl,
+                                         maxResolutions, timer, timeout);
+    if (incomplete != 2)
+      return incomplete ? true : false;
   }
 
   return false;
@@ -307,11 +461,18 @@ void AddressSpace::copyOutConcretes() {
       auto address = reinterpret_cast<std::uint8_t*>(mo->address);
 
       if (!os->readOnly)
-        memcpy(address, os->concreteStore, mo->size);
+        os->concreteStore.copyTo(address);
     }
   }
 }
 
+bool AddressSpace::hasOnlyConcretes() const {
+  for (const auto &obj : objects)
+    if (obj.second->symbolicBytes)
+      return false;
+  return true;
+}
+
 bool AddressSpace::copyInConcretes() {
   for (auto &obj : objects) {
     const MemoryObject *mo = obj.first;
@@ -330,12 +491,12 @@ bool AddressSpace::copyInConcretes() {
 bool AddressSpace::copyInConcrete(const MemoryObject *mo, const ObjectState *os,
                                   uint64_t src_address) {
   auto address = reinterpret_cast<std::uint8_t*>(src_address);
-  if (memcmp(address, os->concreteStore, mo->size) != 0) {
+  if (!os->concreteStore.equals(address)) {
     if (os->readOnly) {
       return false;
     } else {
       ObjectState *wos = getWriteable(mo, os);
-      memcpy(wos->concreteStore, address, mo->size);
+      wos->concreteStore.copyFrom(address);
     }
   }
   return true;
@@ -12,14 +12,17 @@
 
 #include "Memory.h"
 
+#include "klee/Config/config.h"
 #include "klee/Expr/Expr.h"
 #include "klee/ADT/ImmutableMap.h"
+#include "klee/ADT/ImmutableRadixMap.h"
 #include "klee/System/Time.h"
 
 namespace klee {
   class ExecutionState;
   class MemoryObject;
   class ObjectState;
+  class TimerStatIncrementer;
   class TimingSolver;
 
   template<class T> class ref;
@@ -32,8 +35,19 @@ namespace klee {
     bool operator()(const MemoryObject *a, const MemoryObject *b) const;
   };
 
+#ifdef ENABLE_RADIX_MEMORY_MAP
+  /// Function object returning the radix key of a MemoryObject.
+  struct MemoryObjectAddress {
+    uint64_t operator()(const MemoryObject *mo) const { return mo->address; }
+  };
+
+  typedef ImmutableRadixMap<const MemoryObject *, ref<ObjectState>,
+                            MemoryObjectAddress>
+      MemoryMap;
+#else
   typedef ImmutableMap<const MemoryObject *, ref<ObjectState>, MemoryObjectLT>
       MemoryMap;
+#endif
 
   class AddressSpace {
   private:
@@ -54,6 +68,32 @@ namespace klee {
                              ref<Expr> p, const ObjectPair &op,
                              ResolutionList &rl, unsigned maxResolutions) const;
 
+    /// Collect the objects overlapping the address range `p` is bounded to
+    /// by a (constraint independent) range analysis, in address order.
+    void getCandidateObjects(ref<Expr> p, ResolutionList &candidates) const;
+
+    /// Check if pointer `p` can point into any of the objects
+    /// candidates[begin, end), using a single query on the address range
+    /// they span.
+    ///
+    /// \return false iff the query failed.
+    bool mayPointInto(ExecutionState &state, TimingSolver *solver,
+                      ref<Expr> p, const ResolutionList &candidates,
+                      std::size_t begin, std::size_t end,
+                      bool &mayBeTrue) const;
+
+    /// Add the objects in candidates[begin, end) that pointer `p` can point
+    /// to to the given resolution list. Groups of objects are ruled out
+    /// with a single query by recursively halving the range.
+    ///
+    /// \return the same as checkPointerInObject.
+    int checkPointerInObjects(ExecutionState &state, TimingSolver *solver,
+                              ref<Expr> p, const ResolutionList &candidates,
+                              std::size_t begin, std::size_t end,
+                              ResolutionList &rl, unsigned maxResolutions,
+                              const TimerStatIncrementer &timer,
+                              time::Span timeout) const;
+
   public:
     /// The MemoryObject -> ObjectState map that constitutes the
     /// address space.
@@ -128,6 +168,10 @@ namespace klee {
     /// actual system memory location they were allocated at.
     void copyOutConcretes();
 
+    /// Returns true if no managed ObjectState has symbolic contents, in
+    /// which case copyOutConcretes writes out the exact memory contents.
+    bool hasOnlyConcretes() const;
+
     /// Copy the concrete values of all managed ObjectStates back from
     /// the actual system memory location they were allocated
     /// at. ObjectStates will only be written to (and thus,
@@ -47,26 +47,8 @@ std::uint32_t ExecutionState::nextID = 1;
 /***/
 
 StackFrame::StackFrame(KInstIterator _caller, KFunction *_kf)
-  : caller(_caller), kf(_kf), callPathNode(0), 
-    minDistToUncoveredOnReturn(0), varargs(0) {
-  locals = new Cell[kf->numRegisters];
-}
-
-StackFrame::StackFrame(const StackFrame &s) 
-  : caller(s.caller),
-    kf(s.kf),
-    callPathNode(s.callPathNode),
-    allocas(s.allocas),
-    minDistToUncoveredOnReturn(s.minDistToUncoveredOnReturn),
-    varargs(s.varargs) {
-  locals = new Cell[s.kf->numRegisters];
-  for (unsigned i=0; i<s.kf->numRegisters; i++)
-    locals[i] = s.locals[i];
-}
-
-StackFrame::~StackFrame() { 
-  delete[] locals; 
-}
+  : caller(_caller), kf(_kf), callPathNode(0), locals(kf->numRegisters),
+    minDistToUncoveredOnReturn(0), varargs(0) {}
 
 /***/
 
@@ -74,6 +56,7 @@ ExecutionState::ExecutionState(KFunction *kf) :
     pc(kf->instructions),
     prevPC(pc),
     depth(0),
+    pathPrefixPosition(0),
     ptreeNode(nullptr),
     steppedInstructions(0),
     instsSinceCovNew(0),
@@ -97,8 +80,11 @@ ExecutionState::ExecutionState(const ExecutionState& state):
     stack(state.stack),
     incomingBBIndex(state.incomingBBIndex),
     depth(state.depth),
+    pathPrefixPosition(state.pathPrefixPosition),
+    deferredBranchQueries(state.deferredBranchQueries),
     addressSpace(state.addressSpace),
     constraints(state.constraints),
+    models(state.models),
     pathOS(state.pathOS),
     symPathOS(state.symPathOS),
     coveredLines(state.coveredLines),
@@ -282,13 +268,14 @@ bool ExecutionState::merge(const ExecutionState &b) {
     StackFrame &af = *itA;
     const StackFrame &bf = *itB;
     for (unsigned i=0; i<af.kf->numRegisters; i++) {
-      ref<Expr> &av = af.locals[i].value;
+      const ref<Expr> &av = af.locals[i].value;
       const ref<Expr> &bv = bf.locals[i].value;
       if (!av || !bv) {
         // if one is null then by implication (we are at same pc)
         // we cannot reuse this local, so just ignore
       } else {
-        av = SelectExpr::create(inA, av, bv);
+        ref<Expr> merged = SelectExpr::create(inA, av, bv);
+        af.locals.getWriteable(i).value = merged;
       }
     }
   }
@@ -357,4 +344,6 @@ void ExecutionState::dumpStack(llvm::raw_ostream &out) const {
 void ExecutionState::addConstraint(ref<Expr> e) {
   ConstraintManager c(constraints);
   c.addConstraint(e);
+  if (!models.empty())
+    models.restrict(e);
 }
@@ -12,10 +12,12 @@
 
 #include "AddressSpace.h"
 #include "MergeHandler.h"
+#include "ModelPool.h"
 
 #include "klee/ADT/TreeStream.h"
 #include "klee/Expr/Constraints.h"
 #include "klee/Expr/Expr.h"
+#include "klee/Module/Cell.h"
 #include "klee/Module/KInstIterator.h"
 #include "klee/Solver/Solver.h"
 #include "klee/System/Time.h"
@@ -28,7 +30,6 @@
 namespace klee {
 class Array;
 class CallPathNode;
-struct Cell;
 struct KFunction;
 struct KInstruction;
 class MemoryObject;
@@ -43,7 +44,10 @@ struct StackFrame {
   CallPathNode *callPathNode;
 
   std::vector<const MemoryObject *> allocas;
-  Cell *locals;
+
+  /// Registers of the function, shared with the frames this one was copied
+  /// from (when forking) until they are written
+  CopyOnWriteArray<Cell> locals;
 
   /// Minimum distance to an uncovered instruction once the function
   /// returns. This is not a good place for this but is used to
@@ -60,8 +64,6 @@ struct StackFrame {
   MemoryObject *varargs;
 
   StackFrame(KInstIterator caller, KFunction *kf);
-  StackFrame(const StackFrame &s);
-  ~StackFrame();
 };
 
 /// Contains information related to unwinding (Itanium ABI/2-Phase unwinding)
@@ -176,12 +178,23 @@ public:
   /// @brief Exploration depth, i.e., number of times KLEE branched for this state
   std::uint32_t depth;
 
+  /// @brief Number of path prefix decisions consumed by this state
+  std::uint32_t pathPrefixPosition;
+
+  /// @brief Number of times the pending branch query was deferred because it
+  /// did not finish within its time slice
+  std::uint32_t deferredBranchQueries = 0;
+
   /// @brief Address space used by this state (e.g. Global and Heap)
   AddressSpace addressSpace;
 
   /// @brief Constraints collected so far
   ConstraintSet constraints;
 
+  /// @brief Recent assignments satisfying the constraints, used to decide
+  /// branches without querying the solver
+  ModelPool models;
+
   /// Statistics and information
 
   /// @brief Metadata utilized and collected by solvers for this state
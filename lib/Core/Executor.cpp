@@ -121,6 +121,26 @@ cl::opt<std::string> MaxTime(
              "Set to 0s to disable (default=0s)"),
     cl::init("0s"),
     cl::cat(TerminationCat));
+
+cl::opt<unsigned long long> MaxInstructions(
+    "max-instructions",
+    cl::desc("Stop execution after this many instructions.  Set to 0 to disable (default=0)"),
+    cl::init(0),
+    cl::cat(TerminationCat));
+
+cl::opt<unsigned> MaxMemory("max-memory",
+                            cl::desc("Refuse to fork when above this amount of "
+                                     "memory (in MB) (see -max-memory-inhibit) and terminate "
+                                     "states when additional 100MB allocated (default=2000)"),
+                            cl::init(2000),
+                            cl::cat(TerminationCat));
+
+cl::opt<std::string> TimerInterval(
+    "timer-interval",
+    cl::desc("Minimum interval to check timers. "
+             "Affects -max-time, -istats-write-interval, -stats-write-interval, and -uncovered-update-interval (default=1s)"),
+    cl::init("1s"),
+    cl::cat(TerminationCat));
 } // namespace klee
 
 namespace {
@@ -169,6 +189,22 @@ cl::opt<bool>
                                   "querying the solver (default=true)"),
                          cl::cat(SolvingCat));
 
+cl::opt<bool> UseQueryCostModel(
+    "use-query-cost-model", cl::init(false),
+    cl::desc("Predict the solving time of branch queries from their size and "
+             "shape, learning from earlier queries. Branch queries predicted "
+             "to exceed their time slice are deferred without running them "
+             "(requires --branch-query-slice) (default=false)"),
+    cl::cat(SolvingCat));
+
+cl::opt<unsigned> ModelPoolSize(
+    "model-pool-size", cl::init(0),
+    cl::desc("Number of recent satisfying assignments each state keeps. "
+             "Branches whose condition takes both values on them are known "
+             "to be feasible both ways without querying the solver "
+             "(default=0 (off))"),
+    cl::cat(SolvingCat));
+
 
 /*** External call policy options ***/
 
@@ -203,6 +239,20 @@ cl::opt<bool> SuppressExternalWarnings(
     cl::desc("Supress warnings about calling external functions."),
     cl::cat(ExtCallsCat));
 
+cl::opt<bool> NativeCalls(
+    "native-calls",
+    cl::init(false),
+    cl::desc("Execute calls to module functions natively, by compiling them "
+             "with the JIT, when their arguments and all memory are "
+             "concrete. Only functions with loops and without indirect calls "
+             "are considered, and calls that reach other external functions "
+             "or errors are interpreted instead. Native calls are not "
+             "included in coverage and instruction statistics or limits. "
+             "Memory errors in them are not detected: an out-of-bounds "
+             "write in native code corrupts KLEE's own heap "
+             "(default=false)"),
+    cl::cat(ExtCallsCat));
+
 cl::opt<bool> AllExternalWarnings(
     "all-external-warnings",
     cl::init(false),
@@ -299,12 +349,6 @@ cl::list<Executor::TerminateReason> ExitOnErrorType(
     cl::ZeroOrMore,
     cl::cat(TerminationCat));
 
-cl::opt<unsigned long long> MaxInstructions(
-    "max-instructions",
-    cl::desc("Stop execution after this many instructions.  Set to 0 to disable (default=0)"),
-    cl::init(0),
-    cl::cat(TerminationCat));
-
 cl::opt<unsigned>
     MaxForks("max-forks",
              cl::desc("Only fork this many times.  Set to -1 to disable (default=-1)"),
@@ -317,13 +361,6 @@ cl::opt<unsigned> MaxDepth(
     cl::init(0),
     cl::cat(TerminationCat));
 
-cl::opt<unsigned> MaxMemory("max-memory",
-                            cl::desc("Refuse to fork when above this amount of "
-                                     "memory (in MB) (see -max-memory-inhibit) and terminate "
-                                     "states when additional 100MB allocated (default=2000)"),
-                            cl::init(2000),
-                            cl::cat(TerminationCat));
-
 cl::opt<bool> MaxMemoryInhibit(
     "max-memory-inhibit",
     cl::desc(
@@ -365,13 +402,6 @@ cl::opt<double> MaxStaticCPSolvePct(
              "instructions (default=1.0 (always))"),
     cl::cat(TerminationCat));
 
-cl::opt<std::string> TimerInterval(
-    "timer-interval",
-    cl::desc("Minimum interval to check timers. "
-             "Affects -max-time, -istats-write-interval, -stats-write-interval, and -uncovered-update-interval (default=1s)"),
-    cl::init("1s"),
-    cl::cat(TerminationCat));
-
 
 /*** Debugging options ***/
 
@@ -456,7 +486,7 @@ Executor::Executor(LLVMContext &ctx, const InterpreterOptions &opts,
     : Interpreter(opts), interpreterHandler(ih), searcher(0),
       externalDispatcher(new ExternalDispatcher(ctx)), statsTracker(0),
       pathWriter(0), symPathWriter(0), specialFunctionHandler(0), timers{time::Span(TimerInterval)},
-      replayKTest(0), replayPath(0), usingSeeds(0),
+      replayKTest(0), replayPath(0), pathPrefix(0), usingSeeds(0),
       atMemoryLimit(false), inhibitForking(false), haltExecution(false),
       ivcEnabled(false), debugLogBuffer(debugBufferString) {
 
@@ -483,6 +513,8 @@ Executor::Executor(LLVMContext &ctx, const InterpreterOptions &opts,
       interpreterHandler->getOutputFilename(SOLVER_QUERIES_KQUERY_FILE_NAME));
 
   this->solver = new TimingSolver(solver, EqualitySubstitution);
+  if (UseQueryCostModel)
+    this->solver->costModel = std::make_unique<QueryCostModel>();
   memory = new MemoryManager(&arrayCache);
 
   initializeSearchOptions();
@@ -1000,15 +1032,67 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
   time::Span timeout = coreSolverTimeout;
   if (isSeeding)
     timeout *= static_cast<unsigned>(it->second.size());
+
+  // Evaluate the condition on the models of the state first, the solver
+  // is only needed for the sides they do not cover
+  bool useModels = ModelPoolSize && !isSeeding && !isa<ConstantExpr>(condition);
+  bool canBeTrue = false, canBeFalse = false;
+  if (useModels)
+    current.models.evaluate(condition, canBeTrue, canBeFalse);
+  bool decidedByModels = canBeTrue && canBeFalse;
+
+  // Branch queries may be deferred (and re-executed later) if they do not
+  // finish within their time slice
+  bool deferrable = deferringSearcher && !isSeeding && !isInternal &&
+                    !isa<ConstantExpr>(condition) && !decidedByModels;
+  // The cost model only predicts and learns queries with time slices
+  std::unique_ptr<QueryFeatures> features;
+  if (deferrable) {
+    time::Span maxTimeout = timeout;
+    bool lastAttempt;
+    timeout = deferringSearcher->getTimeSlice(current, timeout, lastAttempt);
+    deferrable = !lastAttempt;
+    if (solver->costModel)
+      features = std::make_unique<QueryFeatures>(current.constraints,
+                                                 condition);
+
+    // Do not even try queries that are predicted to exceed their slice, but
+    // let the searcher know what they would cost
+    time::Span predicted =
+        deferrable && features ? solver->predictCost(*features) : time::Span();
+    if (predicted > timeout) {
+      current.queryMetaData.queryCost +=
+          maxTimeout ? std::min(predicted, maxTimeout) : predicted;
+      current.pc = current.prevPC;
+      ++current.deferredBranchQueries;
+      deferringSearcher->deferState(current);
+      return StatePair(0, 0);
+    }
+  }
+
   solver->setTimeout(timeout);
-  bool success = solver->evaluate(current.constraints, condition, res,
-                                  current.queryMetaData);
+  bool success;
+  if (useModels) {
+    success = decidedByModels ||
+              completeModels(current, condition, canBeTrue, canBeFalse);
+    res = !canBeFalse ? Solver::True
+                      : canBeTrue ? Solver::Unknown : Solver::False;
+  } else {
+    success = solver->evaluate(current.constraints, condition, res,
+                               current.queryMetaData, features.get());
+  }
   solver->setTimeout(time::Span());
   if (!success) {
     current.pc = current.prevPC;
-    terminateStateEarly(current, "Query timed out (fork).");
+    if (deferrable) {
+      ++current.deferredBranchQueries;
+      deferringSearcher->deferState(current);
+    } else {
+      terminateStateEarly(current, "Query timed out (fork).");
+    }
     return StatePair(0, 0);
   }
+  current.deferredBranchQueries = 0;
 
   if (!isSeeding) {
     if (replayPath && !isInternal) {
@@ -1030,6 +1114,17 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
           addConstraint(current, Expr::createIsZero(condition));
         }
       }
+    } else if (res == Solver::Unknown && pathPrefix && !isInternal &&
+               current.pathPrefixPosition < pathPrefix->size()) {
+      // Follow the side selected by the path prefix; the other side is
+      // explored by the run with the complementary prefix.
+      if ((*pathPrefix)[current.pathPrefixPosition++]) {
+        res = Solver::True;
+        addConstraint(current, condition);
+      } else {
+        res = Solver::False;
+        addConstraint(current, Expr::createIsZero(condition));
+      }
     } else if (res==Solver::Unknown) {
       assert(!replayKTest && "in replay mode, only one branch can be true.");
       
@@ -1178,6 +1273,41 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
   }
 }
 
+bool Executor::completeModels(ExecutionState &state, ref<Expr> condition,
+                              bool &canBeTrue, bool &canBeFalse) {
+  // Only the constraints sharing array elements with the condition need to
+  // be solved, all other elements keep their values from a model of the
+  // state
+  std::shared_ptr<const Assignment> base = state.models.front();
+  std::vector<ref<Expr>> required;
+  if (base)
+    state.constraints.getIndependentConstraints(condition, required);
+  else
+    required.assign(state.constraints.begin(), state.constraints.end());
+  ConstraintSet factor(required);
+  required.push_back(condition);
+  std::vector<const Array *> objects;
+  findSymbolicObjects(required.begin(), required.end(), objects);
+
+  for (bool side : {true, false}) {
+    bool &feasible = side ? canBeTrue : canBeFalse;
+    if (feasible)
+      continue;
+    std::vector<std::vector<unsigned char>> values;
+    ref<Expr> expr = side ? Expr::createIsZero(condition) : condition;
+    if (!solver->getCounterexample(factor, expr, objects, values, feasible,
+                                   state.queryMetaData))
+      return false;
+    if (!feasible)
+      continue;
+    Assignment model(objects, values);
+    state.models.add(base ? ModelPool::merge(*base, model, required)
+                          : std::make_shared<Assignment>(model),
+                     ModelPoolSize);
+  }
+  return true;
+}
+
 void Executor::addConstraint(ExecutionState &state, ref<Expr> condition) {
   if (ConstantExpr *CE = dyn_cast<ConstantExpr>(condition)) {
     if (!CE->isTrue())
@@ -1776,6 +1906,9 @@ void Executor::executeCall(ExecutionState &state, KInstruction *ki, Function *f,
       transferToBasicBlock(ii->getNormalDest(), i->getParent(), state);
     }
   } else {
+    if (NativeCalls && callNativeFunction(state, ki, f, arguments))
+      return;
+
     // Check if maximum stack size was reached.
     // We currently only count the number of stack frames
     if (RuntimeMaxStackFrames && state.stack.size() > RuntimeMaxStackFrames) {
@@ -1941,6 +2074,15 @@ void Executor::executeCall(ExecutionState &state, KInstruction *ki, Function *f,
   }
 }
 
+void Executor::transferToSuccessor(KInstruction *ki, unsigned successor,
+                                   ExecutionState &state) {
+  // Same as transferToBasicBlock, with the lookups done by KFunction
+  KBranchInstruction *kbi = static_cast<KBranchInstruction *>(ki);
+  KFunction *kf = state.stack.back().kf;
+  state.pc = &kf->instructions[kbi->successorEntries[successor]];
+  state.incomingBBIndex = kbi->incomingBBIndices[successor];
+}
+
 void Executor::transferToBasicBlock(BasicBlock *dst, BasicBlock *src, 
                                     ExecutionState &state) {
   // Note that in general phi nodes can reuse phi values from the same
@@ -2107,7 +2249,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::Br: {
     BranchInst *bi = cast<BranchInst>(i);
     if (bi->isUnconditional()) {
-      transferToBasicBlock(bi->getSuccessor(0), bi->getParent(), state);
+      transferToSuccessor(ki, 0, state);
     } else {
       // FIXME: Find a way that we don't have this hidden dependency.
       assert(bi->getCondition() == bi->getOperand(0) &&
@@ -2125,9 +2267,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
         statsTracker->markBranchVisited(branches.first, branches.second);
 
       if (branches.first)
-        transferToBasicBlock(bi->getSuccessor(0), bi->getParent(), *branches.first);
+        transferToSuccessor(ki, 0, *branches.first);
       if (branches.second)
-        transferToBasicBlock(bi->getSuccessor(1), bi->getParent(), *branches.second);
+        transferToSuccessor(ki, 1, *branches.second);
     }
     break;
   }
@@ -2247,6 +2389,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       ref<Expr> defaultValue = ConstantExpr::alloc(1, Expr::Bool);
 
       // iterate through all non-default cases but in order of the expressions
+      std::vector<ref<Expr> > matches;
+      std::vector<BasicBlock *> matchSuccessors;
       for (std::map<ref<Expr>, BasicBlock *>::iterator
                it = expressionOrder.begin(),
                itE = expressionOrder.end();
@@ -2260,15 +2404,23 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
         // Make sure that the default value does not contain this target's value
         defaultValue = AndExpr::create(defaultValue, Expr::createIsZero(match));
 
-        // Check if control flow could take this case
-        bool result;
-        match = optimizer.optimizeExpr(match, false);
-        bool success = solver->mayBeTrue(state.constraints, match, result,
-                                         state.queryMetaData);
-        assert(success && "FIXME: Unhandled solver failure");
-        (void) success;
-        if (result) {
-          BasicBlock *caseSuccessor = it->second;
+        matches.push_back(optimizer.optimizeExpr(match, false));
+        matchSuccessors.push_back(it->second);
+      }
+      defaultValue = optimizer.optimizeExpr(defaultValue, false);
+      matches.push_back(defaultValue);
+
+      // Check which cases control flow could take, including the default
+      // case, with a single batched query
+      std::vector<bool> feasible;
+      bool success = solver->mayBeTrue(state.constraints, matches, feasible,
+                                       state.queryMetaData);
+      assert(success && "FIXME: Unhandled solver failure");
+      (void) success;
+
+      for (unsigned i = 0; i < matchSuccessors.size(); ++i) {
+        if (feasible[i]) {
+          BasicBlock *caseSuccessor = matchSuccessors[i];
 
           // Handle the case that a basic block might be the target of multiple
           // switch cases.
@@ -2280,7 +2432,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
               branchTargets.insert(std::make_pair(
                   caseSuccessor, ConstantExpr::alloc(0, Expr::Bool)));
 
-          res.first->second = OrExpr::create(match, res.first->second);
+          res.first->second = OrExpr::create(matches[i], res.first->second);
 
           // Only add basic blocks which have not been target of a branch yet
           if (res.second) {
@@ -2290,13 +2442,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       }
 
       // Check if control could take the default case
-      defaultValue = optimizer.optimizeExpr(defaultValue, false);
-      bool res;
-      bool success = solver->mayBeTrue(state.constraints, defaultValue, res,
-                                       state.queryMetaData);
-      assert(success && "FIXME: Unhandled solver failure");
-      (void) success;
-      if (res) {
+      if (feasible.back()) {
         std::pair<std::map<BasicBlock *, ref<Expr> >::iterator, bool> ret =
             branchTargets.insert(
                 std::make_pair(si->getDefaultDest(), defaultValue));
@@ -3366,7 +3512,13 @@ bool Executor::checkMemoryUsage() {
     return true;
 
   // check memory limit
-  const auto mallocUsage = util::GetTotalMallocUsage() >> 20U;
+  std::size_t mallocBytes = util::GetTotalMallocUsage();
+#ifdef ENABLE_EXPR_POOL_ALLOCATOR
+  // Pooled memory that is free for later expressions is not returned to
+  // malloc, so malloc still counts it
+  mallocBytes -= std::min(mallocBytes, ExprAllocator::getFreeBytes());
+#endif
+  const auto mallocUsage = mallocBytes >> 20U;
   const auto mmapUsage = memory->getUsedDeterministicSize() >> 20U;
   const auto totalUsage = mallocUsage + mmapUsage;
   atMemoryLimit = totalUsage > MaxMemory; // inhibit forking
@@ -3568,7 +3720,8 @@ void Executor::terminateState(ExecutionState &state) {
                       "replay did not consume all objects in test input.");
   }
 
-  interpreterHandler->incPathsExplored();
+  if (ownsPath(state))
+    interpreterHandler->incPathsExplored();
 
   std::vector<ExecutionState *>::iterator it =
       std::find(addedStates.begin(), addedStates.end(), &state);
@@ -3588,8 +3741,26 @@ void Executor::terminateState(ExecutionState &state) {
   }
 }
 
+bool Executor::ownsPath(const ExecutionState &state) const {
+  if (!pathPrefix)
+    return true;
+
+  // A path that ends before consuming the whole prefix is reached by every
+  // prefix that shares the consumed decisions; only the one continuing
+  // with false decisions reports it.
+  for (auto i = state.pathPrefixPosition; i < pathPrefix->size(); ++i)
+    if ((*pathPrefix)[i])
+      return false;
+  return true;
+}
+
 void Executor::terminateStateEarly(ExecutionState &state, 
                                    const Twine &message) {
+  if (!ownsPath(state)) {
+    terminateState(state);
+    return;
+  }
+
   if (!OnlyOutputStatesCoveringNew || state.coveredNew ||
       (AlwaysOutputSeeds && seedMap.count(&state)))
     interpreterHandler->processTestCase(state, (message + "\n").str().c_str(),
@@ -3598,8 +3769,9 @@ void Executor::terminateStateEarly(ExecutionState &state,
 }
 
 void Executor::terminateStateOnExit(ExecutionState &state) {
-  if (!OnlyOutputStatesCoveringNew || state.coveredNew || 
-      (AlwaysOutputSeeds && seedMap.count(&state)))
+  if (ownsPath(state) &&
+      (!OnlyOutputStatesCoveringNew || state.coveredNew ||
+       (AlwaysOutputSeeds && seedMap.count(&state))))
     interpreterHandler->processTestCase(state, 0, 0);
   terminateState(state);
 }
@@ -3667,7 +3839,12 @@ void Executor::terminateStateOnError(ExecutionState &state,
   static std::set< std::pair<Instruction*, std::string> > emittedErrors;
   Instruction * lastInst;
   const InstructionInfo &ii = getLastNonKleeInternalInstruction(state, &lastInst);
-  
+
+  if (!ownsPath(state)) {
+    terminateState(state);
+    return;
+  }
+
   if (EmitAllErrors ||
       emittedErrors.insert(std::make_pair(lastInst, message)).second) {
     if (ii.file != "") {
@@ -3843,6 +4020,56 @@ void Executor::callExternalFunction(ExecutionState &state,
   }
 }
 
+bool Executor::callNativeFunction(ExecutionState &state, KInstruction *target,
+                                  Function *function,
+                                  std::vector<ref<Expr>> &arguments) {
+  // allocate 128 bits for each argument (+return value), as for external
+  // calls
+  uint64_t *args = (uint64_t*) alloca(2*sizeof(*args) * (arguments.size() + 1));
+  memset(args, 0, 2 * sizeof(*args) * (arguments.size() + 1));
+  unsigned wordIndex = 2;
+  for (auto &arg : arguments) {
+    ConstantExpr *ce = dyn_cast<ConstantExpr>(arg);
+    if (!ce)
+      return false;
+    ce->toMemory(&args[wordIndex]);
+    wordIndex += (ce->getWidth()+63)/64;
+  }
+
+  // The native code may read any memory, none of which can be symbolic
+  if (!state.addressSpace.hasOnlyConcretes())
+    return false;
+
+  auto addressOf = [this](const GlobalValue *gv) -> uint64_t {
+    auto it = globalAddresses.find(gv);
+    return it == globalAddresses.end() ? 0 : it->second->getZExtValue();
+  };
+  if (!externalDispatcher->prepareNativeCall(function, target->inst,
+                                             addressOf))
+    return false;
+
+  state.addressSpace.copyOutConcretes();
+  if (!externalDispatcher->executeNativeCall(function, args)) {
+    klee_warning_once(function, "interpreting call to %s, which could not be "
+                      "executed natively", function->getName().data());
+    return false;
+  }
+
+  if (!state.addressSpace.copyInConcretes()) {
+    terminateStateOnError(state, "native call modified read-only object",
+                          External);
+    return true;
+  }
+
+  Type *resultType = target->inst->getType();
+  if (!resultType->isVoidTy()) {
+    ref<Expr> e = ConstantExpr::fromMemory((void*) args,
+                                           getWidthForLLVMType(resultType));
+    bindLocal(target, state, e);
+  }
+  return true;
+}
+
 /***/
 
 ref<Expr> Executor::replaceReadWithSymbolic(ExecutionState &state, 
@@ -4086,6 +4313,29 @@ void Executor::executeMemoryOperation(ExecutionState &state,
       value = ConstraintManager::simplifyExpr(state.constraints, value);
   }
 
+  // fastest path: concrete address within a single object, which needs
+  // neither bounds check expressions nor the solver. Errors and
+  // MakeConcreteSymbolic are left to the general path.
+  if (ConstantExpr *CE = dyn_cast<ConstantExpr>(address)) {
+    ObjectPair op;
+    if (state.addressSpace.resolveOne(CE, op)) {
+      const MemoryObject *mo = op.first;
+      const ObjectState *os = op.second;
+      unsigned offset = CE->getZExtValue() - mo->address;
+      if (bytes <= mo->size - offset) {
+        if (isWrite && !os->readOnly) {
+          ObjectState *wos = state.addressSpace.getWriteable(mo, os);
+          wos->write(offset, value);
+          return;
+        }
+        if (!isWrite && !interpreterOpts.MakeConcreteSymbolic) {
+          bindLocal(target, state, os->read(offset, type));
+          return;
+        }
+      }
+    }
+  }
+
   address = optimizer.optimizeExpr(address, true);
 
   // fast path: single in-bounds resolution
@@ -4322,6 +4572,9 @@ void Executor::runFunctionAsMain(Function *f,
   }
 
   ExecutionState *state = new ExecutionState(kmodule->functionMap[f]);
+  // No constraints yet, so the all-zero assignment satisfies them
+  if (ModelPoolSize)
+    state->models.add(std::make_shared<Assignment>(), ModelPoolSize);
 
   if (pathWriter) 
     state->pathOS = pathWriter->open();
@@ -4432,6 +4685,7 @@ bool Executor::getSymbolicSolution(const ExecutionState &state,
 
   ConstraintSet extendedConstraints(state.constraints);
   ConstraintManager cm(extendedConstraints);
+  std::vector<ref<Expr>> preferences;
 
   // Go through each byte in every test case and attempt to restrict
   // it to the constraints contained in cexPreferences.  (Note:
@@ -4457,8 +4711,10 @@ bool Executor::getSymbolicSolution(const ExecutionState &state,
       if (!success) break;
       // If the particular constraint operated on in this iteration through
       // the loop isn't implied then add it to the list of constraints.
-      if (!mustBeTrue)
+      if (!mustBeTrue) {
         cm.addConstraint(*pi);
+        preferences.push_back(*pi);
+      }
     }
     if (pi!=pie) break;
   }
@@ -4467,8 +4723,31 @@ bool Executor::getSymbolicSolution(const ExecutionState &state,
   std::vector<const Array*> objects;
   for (unsigned i = 0; i != state.symbolics.size(); ++i)
     objects.push_back(state.symbolics[i].second);
-  bool success = solver->getInitialValues(extendedConstraints, objects, values,
-                                          state.queryMetaData);
+
+  // A model of the state is a solution, if it also has the preferred values
+  std::shared_ptr<const Assignment> model = state.models.front();
+  if (model) {
+    AssignmentEvaluator evaluator(*model);
+    for (const auto &preference : preferences) {
+      if (!evaluator.visit(preference)->isTrue()) {
+        model = nullptr;
+        break;
+      }
+    }
+  }
+
+  bool success = true;
+  if (model) {
+    for (const Array *array : objects) {
+      auto it = model->bindings.find(array);
+      values.push_back(it != model->bindings.end()
+                           ? it->second
+                           : std::vector<unsigned char>(array->size));
+    }
+  } else {
+    success = solver->getInitialValues(extendedConstraints, objects, values,
+                                       state.queryMetaData);
+  }
   solver->setTimeout(time::Span());
   if (!success) {
     klee_warning("unable to compute initial values (invalid constraints?)!");
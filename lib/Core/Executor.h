@@ -78,6 +78,7 @@ namespace klee {
   class TreeStreamWriter;
   class MergeHandler;
   class MergingSearcher;
+  class DeferringSearcher;
   template<class T> class ref;
 
 
@@ -179,6 +180,10 @@ private:
   /// object.
   unsigned replayPosition;
 
+  /// When non-null a list of branch decisions to be followed on the first
+  /// symbolic forks of every state (see \ref setPathPrefix).
+  const std::vector<bool> *pathPrefix;
+
   /// When non-null a list of "seed" inputs which will be used to
   /// drive execution.
   const std::vector<struct KTest *> *usingSeeds;  
@@ -224,6 +229,10 @@ private:
   /// `nullptr` if merging is disabled
   MergingSearcher *mergingSearcher = nullptr;
 
+  /// Points to the deferring searcher of the searcher chain,
+  /// `nullptr` if branch queries are not time sliced
+  DeferringSearcher *deferringSearcher = nullptr;
+
   /// Typeids used during exception handling
   std::vector<ref<Expr>> eh_typeids;
 
@@ -256,12 +265,21 @@ private:
   void transferToBasicBlock(llvm::BasicBlock *dst, 
 			    llvm::BasicBlock *src,
 			    ExecutionState &state);
+  void transferToSuccessor(KInstruction *ki, unsigned successor,
+                           ExecutionState &state);
 
   void callExternalFunction(ExecutionState &state,
                             KInstruction *target,
                             llvm::Function *function,
                             std::vector< ref<Expr> > &arguments);
 
+  /// Executes a call to a module function natively if possible, see
+  /// ExternalDispatcher::prepareNativeCall.
+  /// \return false if the call has to be interpreted.
+  bool callNativeFunction(ExecutionState &state, KInstruction *target,
+                          llvm::Function *function,
+                          std::vector<ref<Expr>> &arguments);
+
   ObjectState *bindObjectInState(ExecutionState &state, const MemoryObject *mo,
                                  bool isLocal, const Array *array = 0);
 
@@ -355,6 +373,12 @@ private:
   // current state, and one of the states may be null.
   StatePair fork(ExecutionState &current, ref<Expr> condition, bool isInternal);
 
+  /// Queries the solver for a model of each side of condition that the
+  /// models of state do not cover, and adds the models found to the state.
+  /// Returns false if a query failed.
+  bool completeModels(ExecutionState &state, ref<Expr> condition,
+                      bool &canBeTrue, bool &canBeFalse);
+
   /// Add the given (boolean) condition as a constraint on state. This
   /// function is a wrapper around the state's addConstraint function
   /// which also manages propagation of implied values,
@@ -371,12 +395,12 @@ private:
   Cell& getArgumentCell(ExecutionState &state,
                         KFunction *kf,
                         unsigned index) {
-    return state.stack.back().locals[kf->getArgRegister(index)];
+    return state.stack.back().locals.getWriteable(kf->getArgRegister(index));
   }
 
   Cell& getDestCell(ExecutionState &state,
                     KInstruction *target) {
-    return state.stack.back().locals[target->dest];
+    return state.stack.back().locals.getWriteable(target->dest);
   }
 
   void bindLocal(KInstruction *target, 
@@ -427,6 +451,10 @@ private:
 
   bool shouldExitOn(enum TerminateReason termReason);
 
+  // Determines whether the path of \param state is reported by this run
+  // when a \ref pathPrefix is in effect
+  bool ownsPath(const ExecutionState &state) const;
+
   // remove state from queue and delete
   void terminateState(ExecutionState &state);
   // call exit handler and terminate state
@@ -508,6 +536,10 @@ public:
     replayPosition = 0;
   }
 
+  void setPathPrefix(const std::vector<bool> *prefix) override {
+    pathPrefix = prefix;
+  }
+
   llvm::Module *setModule(std::vector<std::unique_ptr<llvm::Module>> &modules,
                           const ModuleOptions &opts) override;
 
@@ -553,6 +585,7 @@ public:
 
   MergingSearcher *getMergingSearcher() const { return mergingSearcher; };
   void setMergingSearcher(MergingSearcher *ms) { mergingSearcher = ms; };
+  void setDeferringSearcher(DeferringSearcher *ds) { deferringSearcher = ds; };
 };
   
 } // End klee namespace
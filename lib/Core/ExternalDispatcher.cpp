@@ -13,20 +13,27 @@
 #if LLVM_VERSION_CODE < LLVM_VERSION(8, 0)
 #include "llvm/IR/CallSite.h"
 #endif
+#include "llvm/Analysis/CFG.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfo.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "llvm/Support/DynamicLibrary.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 
 #include <csetjmp>
 #include <csignal>
+#include <set>
+#include <vector>
 
 using namespace llvm;
 using namespace klee;
@@ -40,6 +47,10 @@ extern "C" {
 static void sigsegv_handler(int signal, siginfo_t *info, void *context) {
   siglongjmp(escapeCallJmpBuf, 1);
 }
+
+// Called by natively executed module code in place of anything it cannot
+// execute natively.
+static void escape_native_call() { siglongjmp(escapeCallJmpBuf, 1); }
 }
 
 namespace klee {
@@ -53,7 +64,14 @@ private:
   llvm::ExecutionEngine *executionEngine;
   LLVMContext &ctx;
   std::map<std::string, void *> preboundFunctions;
-  bool runProtectedCall(llvm::Function *f, uint64_t *args);
+  /// Dispatchers of module functions compiled for native execution, or null
+  /// for functions that cannot be executed natively
+  std::map<const llvm::Function *, llvm::Function *> nativeDispatchers;
+  llvm::Function *createNativeDispatcher(
+      llvm::Function *f, llvm::Instruction *i,
+      const std::function<uint64_t(const llvm::GlobalValue *)> &addressOf);
+  bool runProtectedCall(llvm::Function *f, uint64_t *args,
+                        bool native = false);
   llvm::Module *singleDispatchModule;
   std::vector<std::string> moduleIDs;
   std::string &getFreshModuleID();
@@ -65,6 +83,10 @@ public:
   bool executeCall(llvm::Function *function, llvm::Instruction *i,
                    uint64_t *args);
   void *resolveSymbol(const std::string &name);
+  bool prepareNativeCall(
+      llvm::Function *function, llvm::Instruction *i,
+      const std::function<uint64_t(const llvm::GlobalValue *)> &addressOf);
+  bool executeNativeCall(llvm::Function *function, uint64_t *args);
   int getLastErrno();
   void setLastErrno(int newErrno);
 };
@@ -183,7 +205,9 @@ bool ExternalDispatcherImpl::executeCall(Function *f, Instruction *i,
   // The MCJIT generates whole modules at a time so for every call that we
   // haven't made before we need to create a new Module.
   dispatchModule = new Module(getFreshModuleID(), ctx);
-  dispatcher = createDispatcher(f, i, dispatchModule);
+  dispatcher = resolveSymbol(f->getName().str())
+                   ? createDispatcher(f, i, dispatchModule)
+                   : nullptr;
   dispatchers.insert(std::make_pair(i, dispatcher));
 
   // Force the JIT execution engine to go ahead and build the function. This
@@ -209,10 +233,248 @@ bool ExternalDispatcherImpl::executeCall(Function *f, Instruction *i,
   return runProtectedCall(dispatcher, args);
 }
 
+/// Returns true if calls to the given declaration can be compiled for
+/// native execution
+static bool isNativeIntrinsic(const Function *f) {
+  switch (f->getIntrinsicID()) {
+  case Intrinsic::not_intrinsic:
+  case Intrinsic::vastart:
+  case Intrinsic::vaend:
+  case Intrinsic::vacopy:
+  case Intrinsic::trap:
+  case Intrinsic::debugtrap:
+    return false;
+  default:
+    return true;
+  }
+}
+
+/// Collects the module functions reachable from f through direct calls and
+/// the other global values they use. Returns false if any of them cannot be
+/// compiled for native execution, e.g. because it makes indirect calls
+/// (function addresses in KLEE are not native code) or takes the address of
+/// a function. Sets hasLoop if any of the functions contains a loop.
+static bool collectNativeCode(Function *f, std::vector<Function *> &functions,
+                              std::set<GlobalValue *> &globals,
+                              bool &hasLoop) {
+  std::set<Function *> visited{f};
+  functions.push_back(f);
+  hasLoop = false;
+
+  // Returns false if operand v (not a callee) prevents native execution
+  std::function<bool(Value *)> collectOperand = [&](Value *v) {
+    if (isa<Function>(v) || isa<BlockAddress>(v) || isa<GlobalAlias>(v))
+      return false;
+    if (GlobalValue *gv = dyn_cast<GlobalValue>(v)) {
+      if (!isa<GlobalVariable>(gv))
+        return false;
+      globals.insert(gv);
+      return true;
+    }
+    if (isa<ConstantExpr>(v) || isa<ConstantAggregate>(v)) {
+      for (Value *op : cast<Constant>(v)->operands())
+        if (!collectOperand(op))
+          return false;
+    }
+    return true;
+  };
+
+  for (std::size_t next = 0; next < functions.size(); ++next) {
+    Function *fn = functions[next];
+    if (fn->isVarArg() || fn->hasPersonalityFn())
+      return false;
+
+    SmallVector<std::pair<const BasicBlock *, const BasicBlock *>, 4> backedges;
+    FindFunctionBackedges(*fn, backedges);
+    hasLoop |= !backedges.empty();
+
+    for (auto &bb : *fn) {
+      for (auto &inst : bb) {
+        if (isa<VAArgInst>(inst) || isa<LandingPadInst>(inst) ||
+            isa<IndirectBrInst>(inst) || isa<ResumeInst>(inst))
+          return false;
+
+        const Use *callee = nullptr;
+#if LLVM_VERSION_CODE >= LLVM_VERSION(8, 0)
+        if (auto *cb = dyn_cast<CallBase>(&inst)) {
+          CallInst *ci = dyn_cast<CallInst>(cb);
+          if (!ci || ci->isInlineAsm())
+            return false;
+          callee = &ci->getCalledOperandUse();
+#else
+        if (isa<CallInst>(inst) || isa<InvokeInst>(inst)) {
+          const CallSite cs(&inst);
+          if (!cs.isCall() || cs.isInlineAsm())
+            return false;
+          callee = cs.getCallee();
+#endif
+          Function *target =
+              dyn_cast<Function>(callee->get()->stripPointerCasts());
+          if (!target)
+            return false;
+          if (target->isDeclaration()) {
+            globals.insert(target);
+          } else if (visited.insert(target).second) {
+            functions.push_back(target);
+          }
+        }
+
+        for (const Use &op : inst.operands())
+          if (&op != callee && !collectOperand(op.get()))
+            return false;
+      }
+    }
+  }
+  return true;
+}
+
+Function *ExternalDispatcherImpl::createNativeDispatcher(
+    Function *f, Instruction *i,
+    const std::function<uint64_t(const GlobalValue *)> &addressOf) {
+  const Module *original = f->getParent();
+  if (original->getDataLayout() != executionEngine->getDataLayout())
+    return nullptr;
+
+  // The dispatcher passes on only the types Executor::callNativeFunction
+  // passes
+  FunctionType *fTy = f->getFunctionType();
+  auto isNativeType = [](Type *t) {
+    return t->isPointerTy() || t->isFloatTy() || t->isDoubleTy() ||
+           (t->isIntegerTy() && t->getIntegerBitWidth() <= 64);
+  };
+  if (!fTy->getReturnType()->isVoidTy() && !isNativeType(fTy->getReturnType()))
+    return nullptr;
+  for (Type *param : fTy->params())
+    if (!isNativeType(param))
+      return nullptr;
+
+  // Copying the state's memory in and out costs more than interpreting
+  // code without loops
+  std::vector<Function *> functions;
+  std::set<GlobalValue *> globals;
+  bool hasLoop;
+  if (!collectNativeCode(f, functions, globals, hasLoop) || !hasLoop)
+    return nullptr;
+
+  Module *module = new Module(getFreshModuleID(), ctx);
+  module->setDataLayout(original->getDataLayout());
+  module->setTargetTriple(original->getTargetTriple());
+
+  // Global variables are replaced by the addresses of their memory objects
+  // and calls to functions other than intrinsics escape to the interpreter
+  Type *intPtrTy = Type::getInt64Ty(ctx);
+  Constant *escape = ConstantInt::get(
+      intPtrTy, reinterpret_cast<uintptr_t>(&escape_native_call));
+  ValueToValueMapTy vmap;
+  for (GlobalValue *gv : globals) {
+    Function *decl = dyn_cast<Function>(gv);
+    if (decl && isNativeIntrinsic(decl)) {
+      Function *copy = Function::Create(decl->getFunctionType(),
+                                        decl->getLinkage(), decl->getName(),
+                                        module);
+      copy->copyAttributesFrom(decl);
+      vmap[decl] = copy;
+    } else if (decl) {
+      vmap[decl] = ConstantExpr::getIntToPtr(escape, decl->getType());
+    } else if (uint64_t address = addressOf(gv)) {
+      vmap[gv] = ConstantExpr::getIntToPtr(ConstantInt::get(intPtrTy, address),
+                                           gv->getType());
+    } else {
+      delete module;
+      return nullptr;
+    }
+  }
+
+  for (Function *fn : functions) {
+    Function *copy =
+        Function::Create(fn->getFunctionType(), GlobalValue::InternalLinkage,
+                         fn->getName(), module);
+    vmap[fn] = copy;
+  }
+  Function *entry = cast<Function>(vmap[f]);
+  entry->setName("native_" + f->getName().str() + "_" +
+                 module->getModuleIdentifier());
+  entry->setLinkage(GlobalValue::ExternalLinkage);
+
+  FunctionType *escapeTy = FunctionType::get(Type::getVoidTy(ctx), false);
+  for (Function *fn : functions) {
+    Function *copy = cast<Function>(vmap[fn]);
+    auto arg = copy->arg_begin();
+    for (Argument &a : fn->args())
+      vmap[&a] = &*arg++;
+
+    SmallVector<ReturnInst *, 8> returns;
+#if LLVM_VERSION_CODE >= LLVM_VERSION(13, 0)
+    CloneFunctionInto(copy, fn, vmap, CloneFunctionChangeType::DifferentModule,
+                      returns);
+#else
+    CloneFunctionInto(copy, fn, vmap, /*ModuleLevelChanges=*/true, returns);
+#endif
+
+    // Reaching unreachable code is an error the interpreter reports
+    for (auto &bb : *copy) {
+      if (isa<UnreachableInst>(bb.getTerminator()))
+        CallInst::Create(escapeTy,
+                         ConstantExpr::getIntToPtr(
+                             escape, PointerType::getUnqual(escapeTy)),
+                         ArrayRef<Value *>(), "", bb.getTerminator());
+    }
+  }
+  StripDebugInfo(*module);
+
+  if (verifyModule(*module)) {
+    delete module;
+    return nullptr;
+  }
+
+  Function *dispatcher = createDispatcher(entry, i, module);
+  executionEngine->addModule(std::unique_ptr<Module>(module));
+  uint64_t fnAddr =
+      executionEngine->getFunctionAddress(dispatcher->getName().str());
+  executionEngine->finalizeObject();
+  assert(fnAddr && "failed to get function address");
+  (void)fnAddr;
+  return dispatcher;
+}
+
+bool ExternalDispatcherImpl::prepareNativeCall(
+    Function *f, Instruction *i,
+    const std::function<uint64_t(const GlobalValue *)> &addressOf) {
+  // The dispatcher is created for the call site's function type, so other
+  // call sites are interpreted, without affecting later calls
+  auto *ci = dyn_cast<CallInst>(i);
+  if (!ci || ci->getFunctionType() != f->getFunctionType())
+    return false;
+
+  auto it = nativeDispatchers.find(f);
+  if (it == nativeDispatchers.end())
+    it = nativeDispatchers
+             .emplace(f, createNativeDispatcher(f, i, addressOf))
+             .first;
+  return it->second != nullptr;
+}
+
+bool ExternalDispatcherImpl::executeNativeCall(Function *f, uint64_t *args) {
+  auto it = nativeDispatchers.find(f);
+  assert(it != nativeDispatchers.end() && it->second &&
+         "function not prepared for native execution");
+  if (runProtectedCall(it->second, args, /*native=*/true))
+    return true;
+
+  // Do not try again, as the function is likely to escape again
+  it->second = nullptr;
+  return false;
+}
+
 // FIXME: This is not reentrant.
 static uint64_t *gTheArgsP;
-bool ExternalDispatcherImpl::runProtectedCall(Function *f, uint64_t *args) {
-  struct sigaction segvAction, segvActionOld;
+bool ExternalDispatcherImpl::runProtectedCall(Function *f, uint64_t *args,
+                                              bool native) {
+  // Natively executed module code also escapes on the faults the
+  // interpreter reports as errors, e.g. divisions by zero
+  const int signals[] = {SIGSEGV, SIGFPE, SIGBUS, SIGILL};
+  const unsigned numSignals = native ? 4 : 1;
+  struct sigaction action, oldActions[4];
   bool res;
 
   if (!f)
@@ -221,12 +483,14 @@ bool ExternalDispatcherImpl::runProtectedCall(Function *f, uint64_t *args) {
   std::vector<GenericValue> gvArgs;
   gTheArgsP = args;
 
-  segvAction.sa_handler = nullptr;
-  sigemptyset(&(segvAction.sa_mask));
-  sigaddset(&(segvAction.sa_mask), SIGSEGV);
-  segvAction.sa_flags = SA_SIGINFO;
-  segvAction.sa_sigaction = ::sigsegv_handler;
-  sigaction(SIGSEGV, &segvAction, &segvActionOld);
+  action.sa_handler = nullptr;
+  sigemptyset(&(action.sa_mask));
+  for (unsigned i = 0; i < numSignals; ++i)
+    sigaddset(&(action.sa_mask), signals[i]);
+  action.sa_flags = SA_SIGINFO;
+  action.sa_sigaction = ::sigsegv_handler;
+  for (unsigned i = 0; i < numSignals; ++i)
+    sigaction(signals[i], &action, &oldActions[i]);
 
   if (sigsetjmp(escapeCallJmpBuf, 1)) {
     res = false;
@@ -238,7 +502,8 @@ bool ExternalDispatcherImpl::runProtectedCall(Function *f, uint64_t *args) {
     res = true;
   }
 
-  sigaction(SIGSEGV, &segvActionOld, nullptr);
+  for (unsigned i = 0; i < numSignals; ++i)
+    sigaction(signals[i], &oldActions[i], nullptr);
   return res;
 }
 
@@ -255,9 +520,6 @@ bool ExternalDispatcherImpl::runProtectedCall(Function *f, uint64_t *args) {
 Function *ExternalDispatcherImpl::createDispatcher(Function *target,
                                                    Instruction *inst,
                                                    Module *module) {
-  if (!resolveSymbol(target->getName().str()))
-    return 0;
-
 #if LLVM_VERSION_CODE >= LLVM_VERSION(8, 0)
   const CallBase &cs = cast<CallBase>(*inst);
 #else
@@ -348,6 +610,17 @@ void *ExternalDispatcher::resolveSymbol(const std::string &name) {
   return impl->resolveSymbol(name);
 }
 
+bool ExternalDispatcher::prepareNativeCall(
+    llvm::Function *function, llvm::Instruction *i,
+    const std::function<uint64_t(const llvm::GlobalValue *)> &addressOf) {
+  return impl->prepareNativeCall(function, i, addressOf);
+}
+
+bool ExternalDispatcher::executeNativeCall(llvm::Function *function,
+                                           uint64_t *args) {
+  return impl->executeNativeCall(function, args);
+}
+
 int ExternalDispatcher::getLastErrno() { return impl->getLastErrno(); }
 void ExternalDispatcher::setLastErrno(int newErrno) {
   impl->setLastErrno(newErrno);
@@ -12,12 +12,14 @@
 
 #include "klee/Config/Version.h"
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <stdint.h>
 #include <string>
 
 namespace llvm {
+class GlobalValue;
 class Instruction;
 class LLVMContext;
 class Function;
@@ -41,6 +43,22 @@ public:
                    uint64_t *args);
   void *resolveSymbol(const std::string &name);
 
+  /* Compile the given module function, and the module functions it calls,
+   * for native execution by calls through i. Global variables are placed at
+   * the addresses given by addressOf. Returns false if the function cannot
+   * be executed natively.
+   */
+  bool prepareNativeCall(
+      llvm::Function *function, llvm::Instruction *i,
+      const std::function<uint64_t(const llvm::GlobalValue *)> &addressOf);
+
+  /* Execute a function prepared by prepareNativeCall, passing arguments as
+   * executeCall does. Returns false if the function reached code it cannot
+   * execute natively, in which case it is not prepared anymore. Memory may
+   * have been partially modified in that case.
+   */
+  bool executeNativeCall(llvm::Function *function, uint64_t *args);
+
   int getLastErrno();
   void setLastErrno(int newErrno);
 };
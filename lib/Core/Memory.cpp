@@ -76,10 +76,10 @@ void MemoryObject::getAllocInfo(std::string &result) const {
 ObjectState::ObjectState(const MemoryObject *mo)
   : copyOnWriteOwner(0),
     object(mo),
-    concreteStore(new uint8_t[mo->size]),
+    concreteStore(mo->size),
     concreteMask(0),
+    symbolicBytes(0),
     flushMask(0),
-    knownSymbolics(0),
     updates(0, 0),
     size(mo->size),
     readOnly(false) {
@@ -89,49 +89,39 @@ ObjectState::ObjectState(const MemoryObject *mo)
         getArrayCache()->CreateArray("tmp_arr" + llvm::utostr(++id), size);
     updates = UpdateList(array, 0);
   }
-  memset(concreteStore, 0, size);
 }
 
 
 ObjectState::ObjectState(const MemoryObject *mo, const Array *array)
   : copyOnWriteOwner(0),
     object(mo),
-    concreteStore(new uint8_t[mo->size]),
+    concreteStore(mo->size),
     concreteMask(0),
+    symbolicBytes(0),
     flushMask(0),
-    knownSymbolics(0),
     updates(array, 0),
     size(mo->size),
     readOnly(false) {
   makeSymbolic();
-  memset(concreteStore, 0, size);
 }
 
 ObjectState::ObjectState(const ObjectState &os) 
   : copyOnWriteOwner(0),
     object(os.object),
-    concreteStore(new uint8_t[os.size]),
+    concreteStore(os.concreteStore),
     concreteMask(os.concreteMask ? new BitArray(*os.concreteMask, os.size) : 0),
+    symbolicBytes(os.symbolicBytes),
     flushMask(os.flushMask ? new BitArray(*os.flushMask, os.size) : 0),
-    knownSymbolics(0),
+    knownSymbolics(os.knownSymbolics),
     updates(os.updates),
     size(os.size),
     readOnly(false) {
   assert(!os.readOnly && "no need to copy read only object?");
-  if (os.knownSymbolics) {
-    knownSymbolics = new ref<Expr>[size];
-    for (unsigned i=0; i<size; i++)
-      knownSymbolics[i] = os.knownSymbolics[i];
-  }
-
-  memcpy(concreteStore, os.concreteStore, size*sizeof(*concreteStore));
 }
 
 ObjectState::~ObjectState() {
   delete concreteMask;
   delete flushMask;
-  delete[] knownSymbolics;
-  delete[] concreteStore;
 }
 
 ArrayCache *ObjectState::getArrayCache() const {
@@ -204,7 +194,7 @@ void ObjectState::flushToConcreteStore(TimingSolver *solver,
                      "byte %p+%u will have random value",
                      (void *)object->address, i);
       else
-        ce->toMemory(concreteStore + i);
+        concreteStore.set(i, ce->getZExtValue(8));
     }
   }
 }
@@ -212,10 +202,10 @@ void ObjectState::flushToConcreteStore(TimingSolver *solver,
 void ObjectState::makeConcrete() {
   delete concreteMask;
   delete flushMask;
-  delete[] knownSymbolics;
   concreteMask = 0;
+  symbolicBytes = 0;
   flushMask = 0;
-  knownSymbolics = 0;
+  knownSymbolics = CopyOnWriteArray<ref<Expr> >();
 }
 
 void ObjectState::makeSymbolic() {
@@ -232,15 +222,13 @@ void ObjectState::makeSymbolic() {
 
 void ObjectState::initializeToZero() {
   makeConcrete();
-  memset(concreteStore, 0, size);
+  concreteStore.fill(0);
 }
 
 void ObjectState::initializeToRandom() {  
   makeConcrete();
-  for (unsigned i=0; i<size; i++) {
-    // randomly selected by 256 sided die
-    concreteStore[i] = 0xAB;
-  }
+  // randomly selected by 256 sided die
+  concreteStore.fill(0xAB);
 }
 
 /*
@@ -317,18 +305,23 @@ bool ObjectState::isByteFlushed(unsigned offset) const {
 }
 
 bool ObjectState::isByteKnownSymbolic(unsigned offset) const {
-  return knownSymbolics && knownSymbolics[offset].get();
+  return !knownSymbolics.empty() && knownSymbolics[offset].get();
 }
 
 void ObjectState::markByteConcrete(unsigned offset) {
-  if (concreteMask)
+  if (concreteMask && !concreteMask->get(offset)) {
     concreteMask->set(offset);
+    --symbolicBytes;
+  }
 }
 
 void ObjectState::markByteSymbolic(unsigned offset) {
   if (!concreteMask)
     concreteMask = new BitArray(size, true);
-  concreteMask->unset(offset);
+  if (concreteMask->get(offset)) {
+    concreteMask->unset(offset);
+    ++symbolicBytes;
+  }
 }
 
 void ObjectState::markByteUnflushed(unsigned offset) {
@@ -346,12 +339,13 @@ void ObjectState::markByteFlushed(unsigned offset) {
 
 void ObjectState::setKnownSymbolic(unsigned offset, 
                                    Expr *value /* can be null */) {
-  if (knownSymbolics) {
-    knownSymbolics[offset] = value;
+  if (!knownSymbolics.empty()) {
+    if (value || knownSymbolics[offset].get())
+      knownSymbolics.set(offset, value);
   } else {
     if (value) {
-      knownSymbolics = new ref<Expr>[size];
-      knownSymbolics[offset] = value;
+      knownSymbolics = CopyOnWriteArray<ref<Expr> >(size);
+      knownSymbolics.set(offset, value);
     }
   }
 }
@@ -390,7 +384,7 @@ ref<Expr> ObjectState::read8(ref<Expr> offset) const {
 
 void ObjectState::write8(unsigned offset, uint8_t value) {
   //assert(read_only == false && "writing to read-only object!");
-  concreteStore[offset] = value;
+  concreteStore.set(offset, value);
   setKnownSymbolic(offset, 0);
 
   markByteConcrete(offset);
@@ -456,6 +450,22 @@ ref<Expr> ObjectState::read(ref<Expr> offset, Expr::Width width) const {
 }
 
 ref<Expr> ObjectState::read(unsigned offset, Expr::Width width) const {
+  // Fast path: concrete bytes are combined without intermediate expressions
+  if (width <= 64) {
+    unsigned NumBytes = Expr::getMinBytesForWidth(width);
+    uint64_t value = 0;
+    unsigned i = 0;
+    for (; i != NumBytes; ++i) {
+      unsigned idx = Context::get().isLittleEndian() ? i : (NumBytes - i - 1);
+      if (!isByteConcrete(offset + idx))
+        break;
+      value |= (uint64_t) concreteStore[offset + idx] << (8 * i);
+    }
+    if (i == NumBytes)
+      return ConstantExpr::create(bits64::truncateToNBits(value, width),
+                                  width);
+  }
+
   // Treat bool specially, it is the only non-byte sized write we allow.
   if (width == Expr::Bool)
     return ExtractExpr::create(read8(offset), 0, Expr::Bool);
@@ -13,6 +13,7 @@
 #include "Context.h"
 #include "TimingSolver.h"
 
+#include "klee/ADT/CopyOnWriteArray.h"
 #include "klee/Expr/Expr.h"
 
 #include "llvm/ADT/StringExtras.h"
@@ -178,15 +179,22 @@ private:
 
   ref<const MemoryObject> object;
 
-  uint8_t *concreteStore;
+  // Stored in pages shared with the states this one was copied from, so
+  // that writing after a fork only copies the pages touched. Mutable
+  // because flushToConcreteStore updates it for const objects.
+  mutable CopyOnWriteArray<uint8_t> concreteStore;
 
   // XXX cleanup name of flushMask (its backwards or something)
   BitArray *concreteMask;
 
+  // number of bytes not set in concreteMask
+  unsigned symbolicBytes;
+
   // mutable because may need flushed during read of const
   mutable BitArray *flushMask;
 
-  ref<Expr> *knownSymbolics;
+  // empty if no byte is known symbolic
+  CopyOnWriteArray<ref<Expr> > knownSymbolics;
 
   // mutable because we may need flush during read of const
   mutable UpdateList updates;
@@ -0,0 +1,77 @@
+//===-- ModelPool.cpp -----------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "ModelPool.h"
+
+#include "klee/Expr/ExprUtil.h"
+
+#include <algorithm>
+
+using namespace klee;
+
+namespace {
+bool holds(const Assignment &model, const ref<Expr> &e) {
+  AssignmentEvaluator evaluator(model);
+  return evaluator.visit(e)->isTrue();
+}
+} // namespace
+
+void ModelPool::evaluate(const ref<Expr> &condition, bool &canBeTrue,
+                         bool &canBeFalse) const {
+  canBeTrue = canBeFalse = false;
+  for (const auto &model : models) {
+    if (holds(*model, condition))
+      canBeTrue = true;
+    else
+      canBeFalse = true;
+    if (canBeTrue && canBeFalse)
+      return;
+  }
+}
+
+void ModelPool::restrict(const ref<Expr> &constraint) {
+  models.erase(std::remove_if(models.begin(), models.end(),
+                              [&](const std::shared_ptr<const Assignment> &m) {
+                                return !holds(*m, constraint);
+                              }),
+               models.end());
+}
+
+void ModelPool::add(std::shared_ptr<const Assignment> model,
+                    std::size_t capacity) {
+  models.insert(models.begin(), std::move(model));
+  if (models.size() > capacity)
+    models.resize(capacity);
+}
+
+std::shared_ptr<const Assignment>
+ModelPool::merge(const Assignment &base, const Assignment &model,
+                 const std::vector<ref<Expr>> &exprs) {
+  auto merged = std::make_shared<Assignment>(base);
+  std::vector<ref<ReadExpr>> reads;
+  for (const auto &e : exprs)
+    findReads(e, /* visitUpdates= */ true, reads);
+
+  for (const auto &re : reads) {
+    auto it = model.bindings.find(re->updates.root);
+    if (it == model.bindings.end())
+      continue;
+    std::vector<unsigned char> &values = merged->bindings[it->first];
+    values.resize(it->second.size());
+    // A symbolic index may read any element
+    if (ConstantExpr *CE = dyn_cast<ConstantExpr>(re->index)) {
+      std::uint64_t index = CE->getZExtValue();
+      if (index < values.size())
+        values[index] = it->second[index];
+    } else {
+      values = it->second;
+    }
+  }
+  return merged;
+}
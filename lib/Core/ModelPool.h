@@ -0,0 +1,54 @@
+//===-- ModelPool.h ---------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_MODELPOOL_H
+#define KLEE_MODELPOOL_H
+
+#include "klee/Expr/Assignment.h"
+#include "klee/Expr/Expr.h"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace klee {
+  /// ModelPool holds a few assignments that satisfy the constraints of a
+  /// state, most recent first. Arrays an assignment does not bind are 0.
+  /// Assignments are shared with the states forked from the state.
+  class ModelPool {
+    std::vector<std::shared_ptr<const Assignment>> models;
+
+  public:
+    bool empty() const { return models.empty(); }
+    std::size_t size() const { return models.size(); }
+
+    /// Returns the most recent model, `nullptr` if there is none.
+    std::shared_ptr<const Assignment> front() const {
+      return models.empty() ? nullptr : models.front();
+    }
+
+    /// Returns a copy of base in which the array elements read by exprs
+    /// take their values from model.
+    static std::shared_ptr<const Assignment>
+    merge(const Assignment &base, const Assignment &model,
+          const std::vector<ref<Expr>> &exprs);
+
+    /// Evaluates condition on the models and records which values it takes.
+    void evaluate(const ref<Expr> &condition, bool &canBeTrue,
+                  bool &canBeFalse) const;
+
+    /// Drops the models on which constraint does not hold.
+    void restrict(const ref<Expr> &constraint);
+
+    /// Adds model, dropping the oldest models beyond capacity.
+    void add(std::shared_ptr<const Assignment> model, std::size_t capacity);
+  };
+}
+
+#endif /* KLEE_MODELPOOL_H */
@@ -0,0 +1,106 @@
+//===-- QueryCostModel.cpp ------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "QueryCostModel.h"
+
+#include "klee/Expr/Constraints.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+#include <vector>
+
+using namespace klee;
+
+QueryFeatures::QueryFeatures(const ConstraintSet &constraints,
+                             const ref<Expr> &expr) {
+  std::vector<ref<Expr>> worklist;
+  constraints.getIndependentConstraints(expr, worklist);
+  values[Constraints] = worklist.size();
+  worklist.push_back(expr);
+
+  std::unordered_set<const Expr *> visited;
+  std::unordered_set<const Array *> arrays;
+  std::unordered_set<const UpdateNode *> updates;
+  while (!worklist.empty() && visited.size() < MaxNodes) {
+    ref<Expr> e = worklist.back();
+    worklist.pop_back();
+    if (!visited.insert(e.get()).second)
+      continue;
+
+    values[MaxWidth] = std::max(values[MaxWidth], e->getWidth());
+    switch (e->getKind()) {
+    case Expr::Mul:
+    case Expr::UDiv:
+    case Expr::SDiv:
+    case Expr::URem:
+    case Expr::SRem:
+      if (!isa<ConstantExpr>(e->getKid(0)) && !isa<ConstantExpr>(e->getKid(1)))
+        ++values[Nonlinear];
+      break;
+    case Expr::Read: {
+      const UpdateList &ul = cast<ReadExpr>(e)->updates;
+      arrays.insert(ul.root);
+      values[UpdateDepth] = std::max(values[UpdateDepth], ul.getSize());
+      for (const auto *un = ul.head.get(); un && updates.insert(un).second;
+           un = un->next.get()) {
+        worklist.push_back(un->index);
+        worklist.push_back(un->value);
+      }
+      break;
+    }
+    default:
+      break;
+    }
+
+    for (unsigned i = 0, n = e->getNumKids(); i != n; ++i)
+      worklist.push_back(e->getKid(i));
+  }
+  values[Nodes] = visited.size();
+  values[Arrays] = arrays.size();
+}
+
+std::array<double, QueryCostModel::NumWeights>
+QueryCostModel::inputs(const QueryFeatures &f) {
+  std::array<double, NumWeights> x;
+  x[0] = 1;
+  for (unsigned i = 0; i != QueryFeatures::NumFeatures; ++i)
+    x[i + 1] = std::log1p(f.values[i]);
+  return x;
+}
+
+time::Span QueryCostModel::predict(const QueryFeatures &features) const {
+  if (samples < MinSamples)
+    return {};
+
+  auto x = inputs(features);
+  double y = 0;
+  for (unsigned i = 0; i != NumWeights; ++i)
+    y += weights[i] * x[i];
+  return time::microseconds(
+      static_cast<std::uint64_t>(std::expm1(std::min(std::max(y, 0.), 40.))));
+}
+
+void QueryCostModel::update(const QueryFeatures &features, time::Span actual) {
+  // Normalised least mean squares: a stochastic gradient step whose size
+  // does not depend on the scale of the inputs
+  auto x = inputs(features);
+  double y = std::log1p(actual.toMicroseconds());
+  double predicted = 0, norm = 1e-3;
+  for (unsigned i = 0; i != NumWeights; ++i) {
+    predicted += weights[i] * x[i];
+    norm += x[i] * x[i];
+  }
+
+  const double rate = 0.5;
+  double step = rate * (y - predicted) / norm;
+  for (unsigned i = 0; i != NumWeights; ++i)
+    weights[i] += step * x[i];
+  ++samples;
+}
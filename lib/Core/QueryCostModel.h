@@ -0,0 +1,71 @@
+//===-- QueryCostModel.h ----------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_QUERYCOSTMODEL_H
+#define KLEE_QUERYCOSTMODEL_H
+
+#include "klee/Expr/Expr.h"
+#include "klee/System/Time.h"
+
+#include <array>
+
+namespace klee {
+  class ConstraintSet;
+
+  /// Cheap syntactic features of a query, computed over the query
+  /// expression and the constraints it (transitively) depends on.
+  struct QueryFeatures {
+    enum Feature {
+      Nodes,       ///< distinct expression nodes, up to MaxNodes
+      Constraints, ///< constraints the expression depends on
+      Arrays,      ///< distinct arrays read
+      UpdateDepth, ///< longest update list read from
+      Nonlinear,   ///< multiplications, divisions and remainders of two
+                   ///< symbolic operands
+      MaxWidth,    ///< widest expression, in bits
+      NumFeatures
+    };
+
+    /// Node count at which extraction stops; larger queries are all
+    /// expensive enough to be told apart by the other features
+    static constexpr unsigned MaxNodes = 4096;
+
+    std::array<unsigned, NumFeatures> values{};
+
+    QueryFeatures(const ConstraintSet &constraints, const ref<Expr> &expr);
+  };
+
+  /// QueryCostModel predicts how long a query takes to solve from its
+  /// features. It is a linear model over the logarithms of the features,
+  /// fitted to the logarithm of the solving time, and is trained online
+  /// from the times measured for earlier queries of the same run.
+  class QueryCostModel {
+    static constexpr unsigned NumWeights = QueryFeatures::NumFeatures + 1;
+
+    std::array<double, NumWeights> weights{};
+    unsigned samples = 0;
+
+    static std::array<double, NumWeights> inputs(const QueryFeatures &f);
+
+  public:
+    /// Number of samples needed before predictions are made
+    static constexpr unsigned MinSamples = 32;
+
+    /// Returns the predicted solving time, or 0 if the model has not seen
+    /// enough queries yet.
+    time::Span predict(const QueryFeatures &features) const;
+
+    /// Adds a query that took the given time to the training data.
+    void update(const QueryFeatures &features, time::Span actual);
+
+    unsigned getSamples() const { return samples; }
+  };
+}
+
+#endif /* KLEE_QUERYCOSTMODEL_H */
@@ -519,6 +519,73 @@ void IterativeDeepeningTimeSearcher::printName(llvm::raw_ostream &os) {
 }
 
 
+///
+
+DeferringSearcher::DeferringSearcher(Searcher *baseSearcher,
+                                     time::Span timeSlice)
+  : baseSearcher{baseSearcher}, timeSlice{timeSlice} {};
+
+time::Span DeferringSearcher::getTimeSlice(const ExecutionState &state,
+                                           time::Span maxTimeout,
+                                           bool &lastAttempt) const {
+  time::Span slice = timeSlice;
+  for (unsigned i = 0; i < state.deferredBranchQueries; ++i) {
+    if (maxTimeout && slice >= maxTimeout)
+      break;
+    slice *= 2U;
+  }
+
+  lastAttempt = maxTimeout && slice >= maxTimeout;
+  return lastAttempt ? maxTimeout : slice;
+}
+
+void DeferringSearcher::deferState(ExecutionState &state) {
+  assert(!deferredStates.count(&state));
+  deferredStates.insert(&state);
+  baseSearcher->update(nullptr, {}, {&state});
+}
+
+ExecutionState &DeferringSearcher::selectState() {
+  return baseSearcher->selectState();
+}
+
+void DeferringSearcher::update(ExecutionState *current,
+                               const std::vector<ExecutionState *> &addedStates,
+                               const std::vector<ExecutionState *> &removedStates) {
+  // filter deferred states unknown to underlying searcher
+  std::vector<ExecutionState *> alt;
+  for (const auto state : removedStates) {
+    auto it = deferredStates.find(state);
+    if (it != deferredStates.end())
+      deferredStates.erase(it);
+    else
+      alt.push_back(state);
+  }
+  if (deferredStates.count(current))
+    current = nullptr;
+  baseSearcher->update(current, addedStates, alt);
+
+  // no states left in underlying searcher: retry deferred states
+  if (baseSearcher->empty() && !deferredStates.empty()) {
+    std::vector<ExecutionState *> ds(deferredStates.begin(),
+                                     deferredStates.end());
+    baseSearcher->update(nullptr, ds, std::vector<ExecutionState *>());
+    deferredStates.clear();
+  }
+}
+
+bool DeferringSearcher::empty() {
+  return baseSearcher->empty() && deferredStates.empty();
+}
+
+void DeferringSearcher::printName(llvm::raw_ostream &os) {
+  os << "<DeferringSearcher> timeSlice: " << timeSlice
+     << ", baseSearcher:\n";
+  baseSearcher->printName(os);
+  os << "</DeferringSearcher>\n";
+}
+
+
 ///
 
 InterleavedSearcher::InterleavedSearcher(const std::vector<Searcher*> &_searchers) {
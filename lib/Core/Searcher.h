@@ -289,6 +289,41 @@ namespace klee {
     void printName(llvm::raw_ostream &os) override;
   };
 
+  /// DeferringSearcher keeps slow branch queries from stalling exploration.
+  /// Branch queries get a short time slice first; a state whose query does
+  /// not finish in time is deferred (removed from the underlying searcher)
+  /// and the underlying searcher explores other states. When it runs out of
+  /// states, all deferred states are revived and retry their queries with
+  /// twice their previous slice.
+  class DeferringSearcher final : public Searcher {
+    std::unique_ptr<Searcher> baseSearcher;
+    time::Span timeSlice;
+    std::set<ExecutionState*> deferredStates;
+
+  public:
+    /// \param baseSearcher The underlying searcher (takes ownership).
+    /// \param timeSlice Initial time slice of branch queries.
+    DeferringSearcher(Searcher *baseSearcher, time::Span timeSlice);
+    ~DeferringSearcher() override = default;
+
+    /// Returns the time slice for the next branch query of state, capped at
+    /// maxTimeout (unless it is 0). Sets lastAttempt if the slice reaches
+    /// the cap, in which case the query should not be deferred again.
+    time::Span getTimeSlice(const ExecutionState &state, time::Span maxTimeout,
+                            bool &lastAttempt) const;
+
+    /// Remove state from the searcher chain until all other states have
+    /// been deferred or terminated.
+    void deferState(ExecutionState &state);
+
+    ExecutionState &selectState() override;
+    void update(ExecutionState *current,
+                const std::vector<ExecutionState *> &addedStates,
+                const std::vector<ExecutionState *> &removedStates) override;
+    bool empty() override;
+    void printName(llvm::raw_ostream &os) override;
+  };
+
   /// InterleavedSearcher selects states from a set of searchers in round-robin
   /// manner. It is used for KLEE's default strategy where it switches between
   /// RandomPathSearcher and WeightedRandomSearcher with CoveringNew metric.
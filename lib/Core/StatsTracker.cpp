@@ -12,6 +12,7 @@
 #include "ExecutionState.h"
 
 #include "klee/Config/Version.h"
+#include "klee/Expr/ExprAllocator.h"
 #include "klee/Module/InstructionInfoTable.h"
 #include "klee/Module/KInstruction.h"
 #include "klee/Module/KModule.h"
@@ -460,7 +461,13 @@ void StatsTracker::writeStatsHeader() {
              << "ResolveTime INTEGER,"
              << "QueryCexCacheMisses INTEGER,"
              << "QueryCexCacheHits INTEGER,"
-             << "ArrayHashTime INTEGER"
+             << "ArrayHashTime INTEGER,"
+             << "ExprAllocatedBytes INTEGER,"
+             << "ExprFreeBytes INTEGER,"
+             << "QueryPersistentCacheHits INTEGER,"
+             << "QueryPersistentCacheMisses INTEGER,"
+             << "QueryConstructCacheHits INTEGER,"
+             << "QueryConstructCacheMisses INTEGER"
          << ')';
   char *zErrMsg = nullptr;
   if(sqlite3_exec(statsFile, create.str().c_str(), nullptr, nullptr, &zErrMsg)) {
@@ -493,7 +500,13 @@ void StatsTracker::writeStatsHeader() {
              << "ResolveTime,"
              << "QueryCexCacheMisses,"
              << "QueryCexCacheHits,"
-             << "ArrayHashTime"
+             << "ArrayHashTime,"
+             << "ExprAllocatedBytes,"
+             << "ExprFreeBytes,"
+             << "QueryPersistentCacheHits,"
+             << "QueryPersistentCacheMisses,"
+             << "QueryConstructCacheHits,"
+             << "QueryConstructCacheMisses"
          << ") VALUES ("
              << "?,"
              << "?,"
@@ -514,6 +527,12 @@ void StatsTracker::writeStatsHeader() {
              << "?,"
              << "?,"
              << "?,"
+             << "?,"
+             << "?,"
+             << "?,"
+             << "?,"
+             << "?,"
+             << "?,"
              << "? "
          << ')';
 
@@ -551,6 +570,17 @@ void StatsTracker::writeStatsLine() {
 #else
   sqlite3_bind_int64(insertStmt, 20, -1LL);
 #endif
+#ifdef ENABLE_EXPR_POOL_ALLOCATOR
+  sqlite3_bind_int64(insertStmt, 21, ExprAllocator::getAllocatedBytes());
+  sqlite3_bind_int64(insertStmt, 22, ExprAllocator::getFreeBytes());
+#else
+  sqlite3_bind_int64(insertStmt, 21, -1LL);
+  sqlite3_bind_int64(insertStmt, 22, -1LL);
+#endif
+  sqlite3_bind_int64(insertStmt, 23, stats::queryPersistentCacheHits);
+  sqlite3_bind_int64(insertStmt, 24, stats::queryPersistentCacheMisses);
+  sqlite3_bind_int64(insertStmt, 25, stats::queryConstructCacheHits);
+  sqlite3_bind_int64(insertStmt, 26, stats::queryConstructCacheMisses);
   int errCode = sqlite3_step(insertStmt);
   if(errCode != SQLITE_DONE) klee_error("Error writing stats data: %s", sqlite3_errmsg(statsFile));
   sqlite3_reset(insertStmt);
@@ -15,6 +15,7 @@
 #include "klee/Statistics/Statistics.h"
 #include "klee/Statistics/TimerStatIncrementer.h"
 #include "klee/Solver/Solver.h"
+#include "klee/Solver/SolverImpl.h"
 
 #include "CoreStats.h"
 
@@ -25,7 +26,8 @@ using namespace llvm;
 
 bool TimingSolver::evaluate(const ConstraintSet &constraints, ref<Expr> expr,
                             Solver::Validity &result,
-                            SolverQueryMetaData &metaData) {
+                            SolverQueryMetaData &metaData,
+                            const QueryFeatures *features) {
   // Fast path, to avoid timer and OS overhead.
   if (ConstantExpr *CE = dyn_cast<ConstantExpr>(expr)) {
     result = CE->isTrue() ? Solver::True : Solver::False;
@@ -40,6 +42,11 @@ bool TimingSolver::evaluate(const ConstraintSet &constraints, ref<Expr> expr,
   bool success = solver->evaluate(Query(constraints, expr), result);
 
   metaData.queryCost += timer.delta();
+  // The time of a query that timed out is only a lower bound of its cost.
+  // It is learnt with twice that, so that similar queries are predicted to
+  // exceed the same timeout.
+  if (costModel && features)
+    costModel->update(*features, success ? timer.delta() : timer.delta() * 2U);
 
   return success;
 }
@@ -78,6 +85,27 @@ bool TimingSolver::mayBeTrue(const ConstraintSet &constraints, ref<Expr> expr,
   return true;
 }
 
+bool TimingSolver::mayBeTrue(const ConstraintSet &constraints,
+                             const std::vector<ref<Expr>> &exprs,
+                             std::vector<bool> &results,
+                             SolverQueryMetaData &metaData) {
+  TimerStatIncrementer timer(stats::solverTime);
+
+  bool success;
+  if (simplifyExprs) {
+    std::vector<ref<Expr>> simplified;
+    for (auto const &expr : exprs)
+      simplified.push_back(ConstraintManager::simplifyExpr(constraints, expr));
+    success = solver->mayBeTrue(constraints, simplified, results);
+  } else {
+    success = solver->mayBeTrue(constraints, exprs, results);
+  }
+
+  metaData.queryCost += timer.delta();
+
+  return success;
+}
+
 bool TimingSolver::mayBeFalse(const ConstraintSet &constraints, ref<Expr> expr,
                               bool &result, SolverQueryMetaData &metaData) {
   bool res;
@@ -125,6 +153,32 @@ bool TimingSolver::getInitialValues(
   return success;
 }
 
+bool TimingSolver::getCounterexample(
+    const ConstraintSet &constraints, ref<Expr> expr,
+    const std::vector<const Array *> &objects,
+    std::vector<std::vector<unsigned char>> &result, bool &hasSolution,
+    SolverQueryMetaData &metaData) {
+  // Fast path, to avoid timer and OS overhead.
+  if (ConstantExpr *CE = dyn_cast<ConstantExpr>(expr)) {
+    if (CE->isTrue()) {
+      hasSolution = false;
+      return true;
+    }
+  }
+
+  TimerStatIncrementer timer(stats::solverTime);
+
+  if (simplifyExprs)
+    expr = ConstraintManager::simplifyExpr(constraints, expr);
+
+  bool success = solver->impl->computeInitialValues(
+      Query(constraints, expr), objects, result, hasSolution);
+
+  metaData.queryCost += timer.delta();
+
+  return success;
+}
+
 std::pair<ref<Expr>, ref<Expr>>
 TimingSolver::getRange(const ConstraintSet &constraints, ref<Expr> expr,
                        SolverQueryMetaData &metaData) {
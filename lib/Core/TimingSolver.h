@@ -10,6 +10,8 @@
 #ifndef KLEE_TIMINGSOLVER_H
 #define KLEE_TIMINGSOLVER_H
 
+#include "QueryCostModel.h"
+
 #include "klee/Expr/Constraints.h"
 #include "klee/Expr/Expr.h"
 #include "klee/Solver/Solver.h"
@@ -28,6 +30,13 @@ class TimingSolver {
 public:
   std::unique_ptr<Solver> solver;
   bool simplifyExprs;
+  /// Predicts the solving time of evaluate() queries and is trained on
+  /// those given with their features, `nullptr` if disabled
+  std::unique_ptr<QueryCostModel> costModel;
+
+private:
+  /// Timeout last set on the core solver
+  time::Span timeout;
 
 public:
   /// TimingSolver - Construct a new timing solver.
@@ -38,14 +47,32 @@ public:
   TimingSolver(Solver *_solver, bool _simplifyExprs = true)
       : solver(_solver), simplifyExprs(_simplifyExprs) {}
 
-  void setTimeout(time::Span t) { solver->setCoreSolverTimeout(t); }
+  /// Sets the timeout of the core solver. This is done around most solver
+  /// uses, including those that turn out not to need the solver, so only
+  /// changes are passed on.
+  void setTimeout(time::Span t) {
+    if (t == timeout)
+      return;
+    timeout = t;
+    solver->setCoreSolverTimeout(t);
+  }
+
+  /// Returns the predicted time evaluate() takes for a query with the given
+  /// features, or 0 if there is no prediction.
+  time::Span predictCost(const QueryFeatures &features) const {
+    if (!costModel)
+      return {};
+    return costModel->predict(features);
+  }
 
   char *getConstraintLog(const Query &query) {
     return solver->getConstraintLog(query);
   }
 
+  /// If features are given, the cost model learns the time the query took.
   bool evaluate(const ConstraintSet &, ref<Expr>, Solver::Validity &result,
-                SolverQueryMetaData &metaData);
+                SolverQueryMetaData &metaData,
+                const QueryFeatures *features = nullptr);
 
   bool mustBeTrue(const ConstraintSet &, ref<Expr>, bool &result,
                   SolverQueryMetaData &metaData);
@@ -56,6 +83,9 @@ public:
   bool mayBeTrue(const ConstraintSet &, ref<Expr>, bool &result,
                  SolverQueryMetaData &metaData);
 
+  bool mayBeTrue(const ConstraintSet &, const std::vector<ref<Expr>> &exprs,
+                 std::vector<bool> &results, SolverQueryMetaData &metaData);
+
   bool mayBeFalse(const ConstraintSet &, ref<Expr>, bool &result,
                   SolverQueryMetaData &metaData);
 
@@ -67,6 +97,13 @@ public:
                         std::vector<std::vector<unsigned char>> &result,
                         SolverQueryMetaData &metaData);
 
+  /// Looks for values of objects for which the constraints hold and expr is
+  /// false. hasSolution is set to whether there are any.
+  bool getCounterexample(const ConstraintSet &, ref<Expr> expr,
+                         const std::vector<const Array *> &objects,
+                         std::vector<std::vector<unsigned char>> &result,
+                         bool &hasSolution, SolverQueryMetaData &metaData);
+
   std::pair<ref<Expr>, ref<Expr>> getRange(const ConstraintSet &,
                                            ref<Expr> query,
                                            SolverQueryMetaData &metaData);
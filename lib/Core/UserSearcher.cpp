@@ -58,6 +58,14 @@ cl::opt<bool> UseIterativeDeepeningTimeSearch(
     cl::init(false),
     cl::cat(SearchCat));
 
+cl::opt<std::string> BranchQuerySlice(
+    "branch-query-slice",
+    cl::desc("Give branch queries this much time first. A state whose branch "
+             "query does not finish in time is deferred until all other "
+             "states are deferred or done, and then retries with twice the "
+             "time, up to --max-solver-time (default=0s (off))"),
+    cl::cat(SearchCat));
+
 cl::opt<bool> UseBatchingSearch(
     "use-batching-search",
     cl::desc("Use batching searcher (keep running selected state for N "
@@ -146,6 +154,14 @@ Searcher *klee::constructUserSearcher(Executor &executor) {
     searcher = new IterativeDeepeningTimeSearcher(searcher);
   }
 
+  const time::Span branchQuerySlice{BranchQuerySlice};
+  if (branchQuerySlice) {
+    auto *ds = new DeferringSearcher(searcher, branchQuerySlice);
+    executor.setDeferringSearcher(ds);
+
+    searcher = ds;
+  }
+
   if (UseMerge) {
     auto *ms = new MergingSearcher(searcher);
     executor.setMergingSearcher(ms);
@@ -24,6 +24,9 @@ ArrayCache::CreateArray(const std::string &_name, uint64_t _size,
 
   const Array *array = new Array(_name, _size, constantValuesBegin,
                                  constantValuesEnd, _domain, _range);
+#ifdef ENABLE_ATOMIC_REFCOUNT
+  std::lock_guard<std::mutex> guard(lock);
+#endif
   if (array->isSymbolicArray()) {
     std::pair<ArrayHashMap::const_iterator, bool> success =
         cachedSymbolicArrays.insert(array);
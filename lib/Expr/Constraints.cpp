@@ -9,6 +9,7 @@
 
 #include "klee/Expr/Constraints.h"
 
+#include "klee/Expr/ExprUtil.h"
 #include "klee/Expr/ExprVisitor.h"
 #include "klee/Module/KModule.h"
 #include "klee/Support/OptionCategories.h"
@@ -16,7 +17,9 @@
 #include "llvm/IR/Function.h"
 #include "llvm/Support/CommandLine.h"
 
+#include <algorithm>
 #include <map>
+#include <set>
 
 using namespace klee;
 
@@ -27,6 +30,31 @@ llvm::cl::opt<bool> RewriteEqualities(
                    "constant is added (default=true)"),
     llvm::cl::init(true),
     llvm::cl::cat(SolvingCat));
+
+/// Array accesses of an expression that determine its independence from
+/// other expressions: arrays read at symbolic indices and elements read at
+/// constant indices.
+struct ArrayAccesses {
+  std::set<const Array *> wholeObjects;
+  std::set<std::pair<const Array *, unsigned>> elements;
+
+  explicit ArrayAccesses(const ref<Expr> &e) {
+    std::vector<ref<ReadExpr>> reads;
+    findReads(e, /* visitUpdates= */ true, reads);
+    for (const auto &re : reads) {
+      const Array *array = re->updates.root;
+
+      // Reads of a constant array don't alias.
+      if (array->isConstantArray() && !re->updates.head)
+        continue;
+
+      if (ConstantExpr *CE = dyn_cast<ConstantExpr>(re->index))
+        elements.emplace(array, (unsigned)CE->getZExtValue(32));
+      else
+        wholeObjects.insert(array);
+    }
+  }
+};
 } // namespace
 
 class ExprReplaceVisitor : public ExprVisitor {
@@ -163,16 +191,205 @@ void ConstraintManager::addConstraint(const ref<Expr> &e) {
 ConstraintManager::ConstraintManager(ConstraintSet &_constraints)
     : constraints(_constraints) {}
 
-bool ConstraintSet::empty() const { return constraints.empty(); }
+ConstraintSet::ConstraintSet(const constraints_ty &cs) {
+  for (auto const &constraint : cs)
+    push_back(constraint);
+}
+
+bool ConstraintSet::empty() const { return count == 0; }
+
+const std::vector<const ConstraintSet::Chunk *> &
+ConstraintSet::getChunks() const {
+  std::size_t numChunks = (count + Chunk::Size - 1) / Chunk::Size;
+  if (chunks.size() == numChunks && (!count || chunks.back() == last.get()))
+    return chunks;
+
+  chunks.resize(numChunks);
+  const Chunk *chunk = last.get();
+  for (std::size_t i = numChunks; i != 0; --i) {
+    chunks[i - 1] = chunk;
+    chunk = chunk->parent.get();
+  }
+  return chunks;
+}
 
 klee::ConstraintSet::constraint_iterator ConstraintSet::begin() const {
-  return constraints.begin();
+  return constraint_iterator(getChunks().data(), 0);
 }
 
 klee::ConstraintSet::constraint_iterator ConstraintSet::end() const {
-  return constraints.end();
+  return constraint_iterator(getChunks().data(), count);
+}
+
+size_t ConstraintSet::size() const noexcept { return count; }
+
+void ConstraintSet::push_back(const ref<Expr> &e) {
+  unsigned offset = count % Chunk::Size;
+  bool cached = !chunks.empty() && chunks.back() == last.get();
+  if (offset == 0) {
+    last = new Chunk(last);
+    if (cached || !count)
+      chunks.push_back(last.get());
+  } else if (last->used != offset) {
+    // A copy of this set has already appended to the shared chunk
+    ref<Chunk> copy = new Chunk(last->parent);
+    for (unsigned i = 0; i != offset; ++i)
+      copy->constraints[i] = last->constraints[i];
+    last = copy;
+    if (cached)
+      chunks.back() = last.get();
+  }
+
+  last->constraints[offset] = e;
+  last->used = offset + 1;
+  ++count;
+  hashValue = hashValue * Expr::MAGIC_HASH_CONSTANT + e->hash();
+}
+
+bool ConstraintSet::operator==(const ConstraintSet &b) const {
+  if (count != b.count || hashValue != b.hashValue)
+    return false;
+  if (last.get() == b.last.get())
+    return true;
+  return std::equal(begin(), end(), b.begin());
+}
+
+const ref<Expr> &ConstraintSet::getConstraint(std::size_t index) const {
+  return getChunks()[index / Chunk::Size]->constraints[index % Chunk::Size];
+}
+
+std::size_t ConstraintSet::mergeFactors(Partition &p, std::size_t a,
+                                        std::size_t b) {
+  if (a == b)
+    return a;
+
+  ImmutableSet<std::size_t> membersA = p.members.lookup(a)->second;
+  ImmutableSet<std::size_t> membersB = p.members.lookup(b)->second;
+  if (membersA.size() < membersB.size()) {
+    std::swap(a, b);
+    std::swap(membersA, membersB);
+  }
+
+  // Move the members of the smaller factor to the larger one
+  for (auto it = membersB.begin(), ie = membersB.end(); it != ie; ++it) {
+    membersA = membersA.insert(*it);
+    p.factorOf = p.factorOf.replace(std::make_pair(*it, a));
+  }
+  p.members = p.members.remove(b).replace(std::make_pair(a, membersA));
+  return a;
+}
+
+void ConstraintSet::extendPartition(Partition &p, std::size_t index,
+                                    const ref<Expr> &e) {
+  ArrayAccesses accesses(e);
+
+  std::size_t factor = index;
+  p.factorOf = p.factorOf.insert(std::make_pair(index, index));
+  p.members = p.members.insert(
+      std::make_pair(index, ImmutableSet<std::size_t>().insert(index)));
+  auto join = [&p, &factor](std::size_t constraint) {
+    factor = mergeFactors(p, factor, p.factorOf.lookup(constraint)->second);
+  };
+
+  for (const Array *array : accesses.wholeObjects) {
+    if (auto whole = p.wholeObjects.lookup(array))
+      join(whole->second);
+
+    // A symbolic read may access any element, so all constraints that
+    // access elements of the array now belong to the same factor and the
+    // elements no longer need to be tracked.
+    std::vector<Partition::element_ty> accessed;
+    for (auto it = p.elements.lower_bound(std::make_pair(array, 0u)),
+              ie = p.elements.end();
+         it != ie && it->first.first == array; ++it) {
+      join(it->second);
+      accessed.push_back(it->first);
+    }
+    for (const auto &element : accessed)
+      p.elements = p.elements.remove(element);
+
+    p.wholeObjects = p.wholeObjects.replace(std::make_pair(array, index));
+  }
+
+  for (const auto &element : accesses.elements) {
+    if (accesses.wholeObjects.count(element.first))
+      continue;
+    if (auto whole = p.wholeObjects.lookup(element.first))
+      join(whole->second);
+    else if (auto other = p.elements.lookup(element))
+      join(other->second);
+    else
+      p.elements = p.elements.insert(std::make_pair(element, index));
+  }
+}
+
+const ConstraintSet::Partition &ConstraintSet::getPartition() const {
+  if (!partition.isNull() && partition->size == count)
+    return *partition;
+
+  // Extend a copy, as the current partition may be shared with other sets
+  ref<Partition> extended =
+      partition.isNull() ? new Partition() : new Partition(*partition);
+  for (std::size_t i = extended->size; i != count; ++i)
+    extendPartition(*extended, i, getConstraint(i));
+  extended->size = count;
+  partition = extended;
+  return *partition;
 }
 
-size_t ConstraintSet::size() const noexcept { return constraints.size(); }
+void ConstraintSet::getIndependentConstraints(
+    const ref<Expr> &expr, std::vector<ref<Expr>> &result) const {
+  const Partition &p = getPartition();
+  ArrayAccesses accesses(expr);
+
+  std::set<std::size_t> factors;
+  auto addFactor = [&p, &factors](std::size_t constraint) {
+    factors.insert(p.factorOf.lookup(constraint)->second);
+  };
+  for (const Array *array : accesses.wholeObjects) {
+    if (auto whole = p.wholeObjects.lookup(array))
+      addFactor(whole->second);
+    for (auto it = p.elements.lower_bound(std::make_pair(array, 0u)),
+              ie = p.elements.end();
+         it != ie && it->first.first == array; ++it)
+      addFactor(it->second);
+  }
+  for (const auto &element : accesses.elements) {
+    if (accesses.wholeObjects.count(element.first))
+      continue;
+    if (auto whole = p.wholeObjects.lookup(element.first))
+      addFactor(whole->second);
+    else if (auto other = p.elements.lookup(element))
+      addFactor(other->second);
+  }
+
+  std::vector<std::size_t> required;
+  for (std::size_t factor : factors) {
+    for (std::size_t constraint : p.members.lookup(factor)->second)
+      required.push_back(constraint);
+  }
+  std::sort(required.begin(), required.end());
+  for (std::size_t constraint : required)
+    result.push_back(getConstraint(constraint));
+}
 
-void ConstraintSet::push_back(const ref<Expr> &e) { constraints.push_back(e); }
+void ConstraintSet::getIndependentFactors(
+    std::vector<std::vector<ref<Expr>>> &factors) const {
+  const Partition &p = getPartition();
+
+  // Order the factors by their first constraint
+  std::vector<const ImmutableSet<std::size_t> *> sorted;
+  for (auto it = p.members.begin(), ie = p.members.end(); it != ie; ++it)
+    sorted.push_back(&it->second);
+  std::sort(sorted.begin(), sorted.end(),
+            [](const ImmutableSet<std::size_t> *a,
+               const ImmutableSet<std::size_t> *b) {
+              return a->min() < b->min();
+            });
+
+  for (const ImmutableSet<std::size_t> *members : sorted) {
+    factors.emplace_back();
+    for (std::size_t constraint : *members)
+      factors.back().push_back(getConstraint(constraint));
+  }
+}
@@ -21,6 +21,7 @@
 #include "llvm/Support/raw_ostream.h"
 
 #include <sstream>
+#include <unordered_map>
 
 using namespace klee;
 using namespace llvm;
@@ -39,9 +40,63 @@ cl::opt<bool> ConstArrayOpt(
     cl::cat(klee::ExprCat));
 }
 
+namespace klee {
+llvm::cl::opt<bool> UseExprInterning(
+    "use-expr-interning", llvm::cl::init(false),
+    llvm::cl::desc("Share a single node between all structurally equal "
+                   "non-constant expressions. Not thread-safe "
+                   "(default=false)"),
+    llvm::cl::cat(klee::ExprCat));
+}
+
+namespace {
+/// Interned expressions by hash value. The table does not hold references;
+/// expressions remove themselves when they are destroyed.
+typedef std::unordered_multimap<unsigned, Expr *> InternedExprMap;
+
+InternedExprMap &getInternedExprs() {
+  // Leaked on purpose: expressions may be destroyed by static destructors
+  static InternedExprMap *exprs = new InternedExprMap();
+  return *exprs;
+}
+}
+
 /***/
 
+#ifdef ENABLE_ATOMIC_REFCOUNT
+std::atomic<unsigned> Expr::count(0);
+#else
 unsigned Expr::count = 0;
+#endif
+
+Expr::~Expr() {
+  Expr::count--;
+
+  InternedExprMap &interned = getInternedExprs();
+  if (interned.empty())
+    return;
+  auto range = interned.equal_range(hashValue);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == this) {
+      interned.erase(it);
+      break;
+    }
+  }
+}
+
+ref<Expr> Expr::createCachedExpr(const ref<Expr> &e) {
+  if (!UseExprInterning)
+    return e;
+
+  InternedExprMap &interned = getInternedExprs();
+  auto range = interned.equal_range(e->hash());
+  for (auto it = range.first; it != range.second; ++it)
+    if (it->second->compare(*e) == 0)
+      return it->second;
+
+  interned.emplace(e->hash(), e.get());
+  return e;
+}
 
 ref<Expr> Expr::createTempRead(const Array *array, Expr::Width w) {
   UpdateList ul(array, 0);
@@ -90,7 +145,11 @@ ref<Expr> Expr::createTempRead(const Array *array, Expr::Width w) {
 }
 
 int Expr::compare(const Expr &b) const {
+#ifdef ENABLE_ATOMIC_REFCOUNT
+  static thread_local ExprEquivSet equivs;
+#else
   static ExprEquivSet equivs;
+#endif
   int r = compare(b, equivs);
   equivs.clear();
   return r;
@@ -540,6 +599,14 @@ ref<Expr> ReadExpr::create(const UpdateList &ul, ref<Expr> index) {
   auto un = ul.head.get();
   bool updateListHasSymbolicWrites = false;
   for (; un; un = un->next.get()) {
+    // Compare concrete indices without building an expression
+    if (isa<ConstantExpr>(index) && isa<ConstantExpr>(un->index)) {
+      if (cast<ConstantExpr>(index)->getZExtValue() ==
+          cast<ConstantExpr>(un->index)->getZExtValue())
+        return un->value;
+      continue;
+    }
+
     ref<Expr> cond = EqExpr::create(index, un->index);
     if (ConstantExpr *CE = dyn_cast<ConstantExpr>(cond)) {
       if (CE->isTrue())
@@ -0,0 +1,116 @@
+//===-- ExprAllocator.cpp -------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Expr/ExprAllocator.h"
+
+#include "klee/Config/config.h"
+
+#include "llvm/Support/MemAlloc.h"
+
+#include <new>
+
+#ifdef ENABLE_ATOMIC_REFCOUNT
+#include <atomic>
+#endif
+
+using namespace klee;
+
+namespace {
+constexpr std::size_t ChunkSize = 64 * 1024;
+constexpr std::size_t NumSizeClasses =
+    ExprAllocator::MaxPooledSize / ExprAllocator::Granularity;
+
+struct FreeBlock {
+  FreeBlock *next;
+};
+
+struct Pool {
+  /// Free list for each size class
+  FreeBlock *freeLists[NumSizeClasses] = {};
+
+  /// Unused part of the chunk allocations are carved from
+  char *chunkBegin = nullptr;
+  char *chunkEnd = nullptr;
+};
+
+Pool &getPool() {
+  // Chunks are deliberately never released: objects may outlive the pool
+  // they were allocated from, e.g. when freed by another thread.
+#ifdef ENABLE_ATOMIC_REFCOUNT
+  static thread_local Pool pool;
+#else
+  static Pool pool;
+#endif
+  return pool;
+}
+
+#ifdef ENABLE_ATOMIC_REFCOUNT
+std::atomic<std::size_t> allocatedBytes(0);
+std::atomic<std::size_t> freeBytes(0);
+#else
+std::size_t allocatedBytes = 0;
+std::size_t freeBytes = 0;
+#endif
+
+std::size_t roundUp(std::size_t size) {
+  return (size + ExprAllocator::Granularity - 1) &
+         ~(ExprAllocator::Granularity - 1);
+}
+} // namespace
+
+void *ExprAllocator::allocate(std::size_t size) {
+  if (size > MaxPooledSize) {
+    allocatedBytes += size;
+    return ::operator new(size);
+  }
+
+  size = roundUp(size);
+  allocatedBytes += size;
+
+  Pool &pool = getPool();
+  FreeBlock *&freeList = pool.freeLists[size / Granularity - 1];
+  if (FreeBlock *block = freeList) {
+    freeList = block->next;
+    freeBytes -= size;
+    return block;
+  }
+
+  if (static_cast<std::size_t>(pool.chunkEnd - pool.chunkBegin) < size) {
+    // The rest of the old chunk is too small and left unused
+    pool.chunkBegin = static_cast<char *>(llvm::safe_malloc(ChunkSize));
+    pool.chunkEnd = pool.chunkBegin + ChunkSize;
+    freeBytes += ChunkSize;
+  }
+
+  void *p = pool.chunkBegin;
+  pool.chunkBegin += size;
+  freeBytes -= size;
+  return p;
+}
+
+void ExprAllocator::deallocate(void *p, std::size_t size) {
+  if (size > MaxPooledSize) {
+    allocatedBytes -= size;
+    ::operator delete(p);
+    return;
+  }
+
+  size = roundUp(size);
+  allocatedBytes -= size;
+  freeBytes += size;
+
+  FreeBlock *&freeList = getPool().freeLists[size / Granularity - 1];
+  FreeBlock *block = static_cast<FreeBlock *>(p);
+  block->next = freeList;
+  freeList = block;
+}
+
+std::size_t ExprAllocator::getAllocatedBytes() { return allocatedBytes; }
+
+std::size_t ExprAllocator::getFreeBytes() { return freeBytes; }
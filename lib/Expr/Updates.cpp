@@ -9,7 +9,10 @@
 
 #include "klee/Expr/Expr.h"
 
+#include <algorithm>
 #include <cassert>
+#include <unordered_set>
+#include <vector>
 
 using namespace klee;
 
@@ -26,6 +29,7 @@ UpdateNode::UpdateNode(const ref<UpdateNode> &_next, const ref<Expr> &_index,
   */
   computeHash();
   size = next ? next->size + 1 : 1;
+  compactedSize = next ? next->compactedSize : 0;
 }
 
 extern "C" void vc_DeleteExpr(void*);
@@ -55,7 +59,50 @@ void UpdateList::extend(const ref<Expr> &index, const ref<Expr> &value) {
     assert(root->getRange() == value->getWidth());
   }
 
+  // Replace the most recent write if it is to the same concrete index
+  if (head && isa<ConstantExpr>(index) && isa<ConstantExpr>(head->index) &&
+      cast<ConstantExpr>(index)->getZExtValue() ==
+          cast<ConstantExpr>(head->index)->getZExtValue()) {
+    head = new UpdateNode(head->next, index, value);
+    return;
+  }
+
   head = new UpdateNode(head, index, value);
+
+  // Compaction walks the whole list, so its cost is amortized by only
+  // compacting once the list has doubled in size
+  if (head->size >= 2 * std::max(head->compactedSize, 32u))
+    compact();
+}
+
+void UpdateList::compact() {
+  std::vector<const UpdateNode *> nodes;
+  for (const auto *un = head.get(); un; un = un->next.get())
+    nodes.push_back(un);
+
+  // A write to a concrete index is shadowed by a more recent write to the
+  // same index, whatever was written to symbolic indices in between
+  std::unordered_set<uint64_t> written;
+  std::vector<bool> shadowed(nodes.size());
+  std::size_t deepest = nodes.size();
+  for (std::size_t i = 0; i != nodes.size(); ++i) {
+    if (const auto *CE = dyn_cast<ConstantExpr>(nodes[i]->index)) {
+      if (!written.insert(CE->getZExtValue()).second) {
+        shadowed[i] = true;
+        deepest = i;
+      }
+    }
+  }
+
+  // Rebuild the list above the deepest shadowed write, sharing the rest
+  if (deepest != nodes.size()) {
+    ref<UpdateNode> rebuilt = nodes[deepest]->next;
+    for (std::size_t i = deepest; i-- != 0;)
+      if (!shadowed[i])
+        rebuilt = new UpdateNode(rebuilt, nodes[i]->index, nodes[i]->value);
+    head = rebuilt;
+  }
+  head->compactedSize = head->size;
 }
 
 int UpdateList::compare(const UpdateList &b) const {
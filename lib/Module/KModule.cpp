@@ -464,6 +464,20 @@ KFunction::KFunction(llvm::Function *_function,
       case Instruction::InsertValue:
       case Instruction::ExtractValue:
         ki = new KGEPInstruction(); break;
+      case Instruction::Br: {
+        // Resolve the successors now rather than on every transfer
+        BranchInst *bi = cast<BranchInst>(&*it);
+        KBranchInstruction *kbi = new KBranchInstruction();
+        for (unsigned j = 0; j < bi->getNumSuccessors(); ++j) {
+          BasicBlock *succ = bi->getSuccessor(j);
+          kbi->successorEntries[j] = basicBlockEntry[succ];
+          kbi->incomingBBIndices[j] = 0;
+          if (PHINode *first = dyn_cast<PHINode>(&succ->front()))
+            kbi->incomingBBIndices[j] = first->getBasicBlockIndex(&*bbit);
+        }
+        ki = kbi;
+        break;
+      }
       default:
         ki = new KInstruction(); break;
       }
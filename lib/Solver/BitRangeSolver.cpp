@@ -0,0 +1,870 @@
+//===-- BitRangeSolver.cpp ------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Solver/Solver.h"
+
+#include "klee/ADT/Bits.h"
+#include "klee/Expr/Assignment.h"
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/Expr.h"
+#include "klee/Expr/ExprUtil.h"
+#include "klee/Solver/IncompleteSolver.h"
+
+#include <algorithm>
+#include <cassert>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+/// Abstract value of an expression of at most 64 bits: the bits that are
+/// known to be zero or one, and an unsigned interval. Both are kept
+/// consistent with each other. Wider expressions are never known.
+struct BitRange {
+  unsigned width;
+  /// No concrete value is possible
+  bool empty = false;
+  std::uint64_t zeros = 0, ones = 0;
+  std::uint64_t min = 0, max;
+
+  explicit BitRange(unsigned _width = 1) : width(_width), max(mask(_width)) {}
+
+  static std::uint64_t mask(unsigned width) {
+    return width > 64 ? ~UINT64_C(0) : bits64::maxValueOfNBits(width);
+  }
+
+  static BitRange none(unsigned width) {
+    BitRange r(width);
+    r.empty = true;
+    return r;
+  }
+  static BitRange constant(unsigned width, std::uint64_t value) {
+    BitRange r(width);
+    r.ones = r.min = r.max = value;
+    r.zeros = ~value & mask(width);
+    return r;
+  }
+  static BitRange interval(unsigned width, std::uint64_t min,
+                           std::uint64_t max) {
+    BitRange r(width);
+    r.min = min;
+    r.max = max;
+    r.normalize();
+    return r;
+  }
+  static BitRange known(unsigned width, std::uint64_t zeros,
+                        std::uint64_t ones) {
+    BitRange r(width);
+    r.zeros = zeros;
+    r.ones = ones;
+    r.normalize();
+    return r;
+  }
+
+  bool isWide() const { return width > 64; }
+  bool isConstant() const { return !empty && !isWide() && min == max; }
+  bool isTrue() const { return isConstant() && min; }
+  bool isFalse() const { return isConstant() && !min; }
+
+  bool contains(std::uint64_t value) const {
+    return !empty && min <= value && value <= max && !(value & zeros) &&
+           (value & ones) == ones;
+  }
+
+  bool operator==(const BitRange &b) const {
+    if (empty || b.empty)
+      return empty == b.empty;
+    return zeros == b.zeros && ones == b.ones && min == b.min && max == b.max;
+  }
+  bool operator!=(const BitRange &b) const { return !(*this == b); }
+
+  /// Tightens the interval with the known bits and vice versa
+  void normalize() {
+    if (empty || isWide())
+      return;
+    std::uint64_t m = mask(width);
+    zeros &= m;
+    ones &= m;
+    max = std::min(max, m & ~zeros);
+    min = std::max(min, ones);
+    if ((zeros & ones) || min > max) {
+      empty = true;
+      return;
+    }
+
+    // The bits above the highest bit in which min and max differ are known
+    std::uint64_t diff = min ^ max;
+    std::uint64_t common =
+        diff ? m & ~((UINT64_C(2) << (63 - __builtin_clzll(diff))) - 1) : m;
+    if ((min & common & zeros) || (~min & common & ones)) {
+      empty = true;
+      return;
+    }
+    ones |= min & common;
+    zeros |= ~min & common;
+  }
+
+  BitRange meet(const BitRange &b) const {
+    if (empty || isWide())
+      return *this;
+    BitRange r(width);
+    r.empty = b.empty;
+    r.zeros = zeros | b.zeros;
+    r.ones = ones | b.ones;
+    r.min = std::max(min, b.min);
+    r.max = std::min(max, b.max);
+    r.normalize();
+    return r;
+  }
+
+  BitRange join(const BitRange &b) const {
+    if (empty)
+      return b;
+    if (b.empty || isWide())
+      return *this;
+    BitRange r(width);
+    r.zeros = zeros & b.zeros;
+    r.ones = ones & b.ones;
+    r.min = std::min(min, b.min);
+    r.max = std::max(max, b.max);
+    r.normalize();
+    return r;
+  }
+
+  /// Returns the signed interval of this value, or false if it contains
+  /// both negative and non-negative values
+  bool getSignedInterval(std::int64_t &smin, std::int64_t &smax) const {
+    std::uint64_t sign = UINT64_C(1) << (width - 1);
+    if ((min & sign) != (max & sign))
+      return false;
+    unsigned shift = 64 - width;
+    smin = static_cast<std::int64_t>(min << shift) >> shift;
+    smax = static_cast<std::int64_t>(max << shift) >> shift;
+    return true;
+  }
+};
+
+/// Known bits of a + b + carry, as computed by LLVM's KnownBits
+BitRange addKnownBits(const BitRange &a, const BitRange &b, unsigned carry) {
+  std::uint64_t m = BitRange::mask(a.width);
+  std::uint64_t sumZero = ((~a.zeros & m) + (~b.zeros & m) + carry) & m;
+  std::uint64_t sumOne = (a.ones + b.ones + carry) & m;
+  std::uint64_t carryKnownZero = ~(sumZero ^ a.zeros ^ b.zeros);
+  std::uint64_t carryKnownOne = sumOne ^ a.ones ^ b.ones;
+  std::uint64_t known = (a.zeros | a.ones) & (b.zeros | b.ones) &
+                        (carryKnownZero | carryKnownOne) & m;
+  return BitRange::known(a.width, ~sumZero & known, sumOne & known);
+}
+
+/// BitRangeAnalysis computes abstract values of expressions, given the
+/// abstract values of array elements. Elements are narrowed by assuming
+/// that expressions have some value, which is propagated backwards through
+/// the expressions.
+class BitRangeAnalysis {
+  typedef std::pair<const Array *, std::uint64_t> element_ty;
+
+  /// Values of the array elements that are known to be narrower than
+  /// their width
+  std::map<element_ty, BitRange> elements;
+  /// Values of expressions, valid for the current elements
+  std::unordered_map<const Expr *, BitRange> values;
+
+  BitRange evalUncached(const ref<Expr> &e);
+  BitRange evalRead(const ReadExpr &re);
+  BitRange readElement(const UpdateList &ul, std::uint64_t index);
+
+  void refineRead(const UpdateList &ul, std::uint64_t index,
+                  const BitRange &v);
+  void refineElement(const Array *array, std::uint64_t index,
+                     const BitRange &v);
+
+public:
+  /// Some element has been narrowed since this was last reset
+  bool changed = false;
+  /// An expression was assumed to have a value it cannot have
+  bool conflict = false;
+
+  BitRange eval(const ref<Expr> &e);
+
+  /// Narrows the array elements e depends on, assuming that the value of e
+  /// is in v. Sets conflict if this is impossible.
+  void refine(const ref<Expr> &e, const BitRange &v);
+
+  /// Picks values for the elements of objects at the low or high end of
+  /// their ranges. All other elements are 0.
+  void pickValues(const std::vector<const Array *> &objects, bool high,
+                  std::vector<std::vector<unsigned char>> &result) const;
+};
+
+BitRange BitRangeAnalysis::eval(const ref<Expr> &e) {
+  auto it = values.find(e.get());
+  if (it != values.end())
+    return it->second;
+  BitRange v = evalUncached(e);
+  values.emplace(e.get(), v);
+  return v;
+}
+
+BitRange BitRangeAnalysis::readElement(const UpdateList &ul,
+                                       std::uint64_t index) {
+  const Array *root = ul.root;
+  BitRange result = BitRange::none(root->getRange());
+  for (const auto *un = ul.head.get(); un; un = un->next.get()) {
+    BitRange ui = eval(un->index);
+    if (ui.isConstant() && ui.min == index)
+      return result.join(eval(un->value));
+    if (ui.isWide() || ui.contains(index))
+      result = result.join(eval(un->value));
+  }
+
+  if (root->isConstantArray()) {
+    if (index >= root->size)
+      return BitRange(root->getRange());
+    const ref<ConstantExpr> &value = root->constantValues[index];
+    return result.join(
+        BitRange::constant(value->getWidth(), value->getZExtValue()));
+  }
+  auto it = elements.find(element_ty(root, index));
+  return result.join(it != elements.end() ? it->second
+                                          : BitRange(root->getRange()));
+}
+
+BitRange BitRangeAnalysis::evalRead(const ReadExpr &re) {
+  const Array *root = re.updates.root;
+  BitRange index = eval(re.index);
+  if (index.empty)
+    return BitRange::none(root->getRange());
+  if (index.isConstant())
+    return readElement(re.updates, index.min);
+
+  // Join the elements that may be read, if there are only a few. Reads out
+  // of bounds may return anything.
+  if (index.isWide() || root->getRange() > 64 || index.max >= root->size ||
+      index.max - index.min >= 64)
+    return BitRange(root->getRange());
+  BitRange result = BitRange::none(root->getRange());
+  for (std::uint64_t i = index.min; i <= index.max; ++i)
+    if (index.contains(i))
+      result = result.join(readElement(re.updates, i));
+  return result;
+}
+
+BitRange BitRangeAnalysis::evalUncached(const ref<Expr> &e) {
+  unsigned width = e->getWidth();
+  if (const ConstantExpr *CE = dyn_cast<ConstantExpr>(e))
+    return width > 64 ? BitRange(width)
+                      : BitRange::constant(width, CE->getZExtValue());
+  if (const ReadExpr *RE = dyn_cast<ReadExpr>(e))
+    return evalRead(*RE);
+
+  BitRange k[3];
+  unsigned numKids = e->getNumKids();
+  assert(numKids <= 3);
+  bool wideKids = false;
+  for (unsigned i = 0; i != numKids; ++i) {
+    k[i] = eval(e->getKid(i));
+    if (k[i].empty)
+      return BitRange::none(width);
+    wideKids |= k[i].isWide();
+  }
+  if (width > 64 || wideKids)
+    return BitRange(width);
+
+  std::uint64_t m = BitRange::mask(width);
+  switch (e->getKind()) {
+  case Expr::NotOptimized:
+    return k[0];
+
+  case Expr::Select:
+    if (k[0].isConstant())
+      return k[0].min ? k[1] : k[2];
+    return k[1].join(k[2]);
+
+  case Expr::Concat: {
+    unsigned shift = k[1].width;
+    BitRange r(width);
+    r.zeros = (k[0].zeros << shift) | k[1].zeros;
+    r.ones = (k[0].ones << shift) | k[1].ones;
+    r.min = (k[0].min << shift) | k[1].min;
+    r.max = (k[0].max << shift) | k[1].max;
+    r.normalize();
+    return r;
+  }
+
+  case Expr::Extract: {
+    unsigned offset = cast<ExtractExpr>(e)->offset;
+    BitRange r = BitRange::known(width, k[0].zeros >> offset,
+                                 k[0].ones >> offset);
+    // The interval carries over if the bits above the extract are fixed
+    if (offset + width >= k[0].width ||
+        k[0].min >> (offset + width) == k[0].max >> (offset + width))
+      r = r.meet(BitRange::interval(width, (k[0].min >> offset) & m,
+                                    (k[0].max >> offset) & m));
+    return r;
+  }
+
+  case Expr::ZExt: {
+    BitRange r = k[0];
+    r.width = width;
+    r.zeros |= m & ~BitRange::mask(k[0].width);
+    return r;
+  }
+
+  case Expr::SExt: {
+    std::uint64_t sign = UINT64_C(1) << (k[0].width - 1);
+    std::uint64_t extension = m & ~BitRange::mask(k[0].width);
+    BitRange r = k[0];
+    r.width = width;
+    if (k[0].zeros & sign) {
+      r.zeros |= extension;
+    } else if (k[0].ones & sign) {
+      r.ones |= extension;
+      r.min |= extension;
+      r.max |= extension;
+    } else {
+      r.min = 0;
+      r.max = m;
+    }
+    r.normalize();
+    return r;
+  }
+
+  case Expr::Add: {
+    BitRange r = addKnownBits(k[0], k[1], 0);
+    if (k[0].max <= m - k[1].max)
+      r = r.meet(BitRange::interval(width, k[0].min + k[1].min,
+                                    k[0].max + k[1].max));
+    return r;
+  }
+
+  case Expr::Sub: {
+    BitRange notB = k[1];
+    std::swap(notB.zeros, notB.ones);
+    BitRange r = addKnownBits(k[0], notB, 1);
+    // Either no or all differences wrap around
+    if (k[0].min >= k[1].max || k[0].max < k[1].min)
+      r = r.meet(BitRange::interval(width, (k[0].min - k[1].max) & m,
+                                    (k[0].max - k[1].min) & m));
+    return r;
+  }
+
+  case Expr::Mul: {
+    if (k[0].isConstant() && k[1].isConstant())
+      return BitRange::constant(width, (k[0].min * k[1].min) & m);
+    // Trailing zeros add up
+    std::uint64_t maybeOnes[2] = {~k[0].zeros & m, ~k[1].zeros & m};
+    if (!maybeOnes[0] || !maybeOnes[1])
+      return BitRange::constant(width, 0);
+    unsigned zeros = std::min<unsigned>(
+        width, __builtin_ctzll(maybeOnes[0]) + __builtin_ctzll(maybeOnes[1]));
+    BitRange r = BitRange::known(width, BitRange::mask(zeros), 0);
+    if (!k[1].max || k[0].max <= m / k[1].max)
+      r = r.meet(BitRange::interval(width, k[0].min * k[1].min,
+                                    k[0].max * k[1].max));
+    return r;
+  }
+
+  case Expr::UDiv:
+    if (!k[1].min)
+      return BitRange(width);
+    return BitRange::interval(width, k[0].min / k[1].max,
+                              k[0].max / k[1].min);
+
+  case Expr::URem:
+    if (!k[1].min)
+      return BitRange(width);
+    if (k[0].max < k[1].min)
+      return k[0];
+    return BitRange::interval(width, 0, std::min(k[0].max, k[1].max - 1));
+
+  case Expr::Not: {
+    BitRange r(width);
+    r.zeros = k[0].ones;
+    r.ones = k[0].zeros;
+    r.min = m - k[0].max;
+    r.max = m - k[0].min;
+    return r;
+  }
+
+  case Expr::And: {
+    BitRange r = BitRange::known(width, k[0].zeros | k[1].zeros,
+                                 k[0].ones & k[1].ones);
+    return r.meet(BitRange::interval(width, 0, std::min(k[0].max, k[1].max)));
+  }
+
+  case Expr::Or: {
+    BitRange r = BitRange::known(width, k[0].zeros & k[1].zeros,
+                                 k[0].ones | k[1].ones);
+    return r.meet(BitRange::interval(width, std::max(k[0].min, k[1].min), m));
+  }
+
+  case Expr::Xor:
+    return BitRange::known(
+        width, (k[0].zeros & k[1].zeros) | (k[0].ones & k[1].ones),
+        (k[0].zeros & k[1].ones) | (k[0].ones & k[1].zeros));
+
+  case Expr::Shl:
+  case Expr::LShr:
+  case Expr::AShr: {
+    if (!k[1].isConstant() || k[1].min >= width)
+      return BitRange(width);
+    unsigned shift = k[1].min;
+    std::uint64_t vacated;
+    if (e->getKind() == Expr::Shl) {
+      vacated = BitRange::mask(shift);
+      BitRange r = BitRange::known(width, (k[0].zeros << shift) | vacated,
+                                   k[0].ones << shift);
+      if (k[0].max <= m >> shift)
+        r = r.meet(
+            BitRange::interval(width, k[0].min << shift, k[0].max << shift));
+      return r;
+    }
+    vacated = m & ~(m >> shift);
+    std::uint64_t sign = UINT64_C(1) << (width - 1);
+    if (e->getKind() == Expr::LShr || (k[0].zeros & sign)) {
+      BitRange r = BitRange::known(width, (k[0].zeros >> shift) | vacated,
+                                   k[0].ones >> shift);
+      return r.meet(
+          BitRange::interval(width, k[0].min >> shift, k[0].max >> shift));
+    }
+    if (k[0].ones & sign) {
+      BitRange r = BitRange::known(width, k[0].zeros >> shift,
+                                   (k[0].ones >> shift) | vacated);
+      return r.meet(BitRange::interval(width, (k[0].min >> shift) | vacated,
+                                       (k[0].max >> shift) | vacated));
+    }
+    return BitRange::known(width, k[0].zeros >> shift, k[0].ones >> shift);
+  }
+
+  case Expr::Eq:
+  case Expr::Ne: {
+    bool ne = e->getKind() == Expr::Ne;
+    if (k[0].isConstant() && k[1].isConstant())
+      return BitRange::constant(1, (k[0].min == k[1].min) != ne);
+    if (k[0].max < k[1].min || k[1].max < k[0].min ||
+        (k[0].ones & k[1].zeros) || (k[0].zeros & k[1].ones))
+      return BitRange::constant(1, ne);
+    return BitRange(1);
+  }
+
+  case Expr::Ult:
+  case Expr::Ugt:
+  case Expr::Ule:
+  case Expr::Uge: {
+    bool swap = e->getKind() == Expr::Ugt || e->getKind() == Expr::Uge;
+    bool strict = e->getKind() == Expr::Ult || e->getKind() == Expr::Ugt;
+    const BitRange &a = swap ? k[1] : k[0], &b = swap ? k[0] : k[1];
+    if (strict ? a.max < b.min : a.max <= b.min)
+      return BitRange::constant(1, 1);
+    if (strict ? a.min >= b.max : a.min > b.max)
+      return BitRange::constant(1, 0);
+    return BitRange(1);
+  }
+
+  case Expr::Slt:
+  case Expr::Sgt:
+  case Expr::Sle:
+  case Expr::Sge: {
+    bool swap = e->getKind() == Expr::Sgt || e->getKind() == Expr::Sge;
+    bool strict = e->getKind() == Expr::Slt || e->getKind() == Expr::Sgt;
+    const BitRange &a = swap ? k[1] : k[0], &b = swap ? k[0] : k[1];
+    std::int64_t aMin, aMax, bMin, bMax;
+    if (!a.getSignedInterval(aMin, aMax) || !b.getSignedInterval(bMin, bMax))
+      return BitRange(1);
+    if (strict ? aMax < bMin : aMax <= bMin)
+      return BitRange::constant(1, 1);
+    if (strict ? aMin >= bMax : aMin > bMax)
+      return BitRange::constant(1, 0);
+    return BitRange(1);
+  }
+
+  default:
+    return BitRange(width);
+  }
+}
+
+void BitRangeAnalysis::refineElement(const Array *array, std::uint64_t index,
+                                     const BitRange &v) {
+  element_ty element(array, index);
+  auto it = elements.find(element);
+  BitRange current = it != elements.end() ? it->second
+                                          : BitRange(array->getRange());
+  BitRange narrowed = current.meet(v);
+  if (narrowed.empty) {
+    conflict = true;
+  } else if (narrowed != current) {
+    elements[element] = narrowed;
+    values.clear();
+    changed = true;
+  }
+}
+
+void BitRangeAnalysis::refineRead(const UpdateList &ul, std::uint64_t index,
+                                  const BitRange &v) {
+  for (const auto *un = ul.head.get(); un; un = un->next.get()) {
+    BitRange ui = eval(un->index);
+    if (ui.isConstant() && ui.min == index)
+      return refine(un->value, v);
+    // The element may have been written here
+    if (ui.isWide() || ui.contains(index))
+      return;
+  }
+  if (!ul.root->isConstantArray() && index < ul.root->size)
+    refineElement(ul.root, index, v);
+}
+
+void BitRangeAnalysis::refine(const ref<Expr> &e, const BitRange &v) {
+  if (conflict || v.isWide())
+    return;
+  BitRange current = eval(e);
+  BitRange narrowed = current.meet(v);
+  if (narrowed.empty) {
+    conflict = true;
+    return;
+  }
+  if (narrowed == current)
+    return;
+
+  unsigned width = e->getWidth();
+  std::uint64_t m = BitRange::mask(width);
+  switch (e->getKind()) {
+  case Expr::NotOptimized:
+    return refine(e->getKid(0), narrowed);
+
+  case Expr::Read: {
+    const ReadExpr *re = cast<ReadExpr>(e);
+    BitRange index = eval(re->index);
+    if (index.isConstant())
+      refineRead(re->updates, index.min, narrowed);
+    return;
+  }
+
+  case Expr::Not: {
+    BitRange r(width);
+    r.zeros = narrowed.ones;
+    r.ones = narrowed.zeros;
+    r.min = m - narrowed.max;
+    r.max = m - narrowed.min;
+    return refine(e->getKid(0), r);
+  }
+
+  case Expr::ZExt: {
+    unsigned kidWidth = e->getKid(0)->getWidth();
+    std::uint64_t kidMask = BitRange::mask(kidWidth);
+    if (narrowed.min > kidMask) {
+      conflict = true;
+      return;
+    }
+    BitRange r(kidWidth);
+    r.zeros = narrowed.zeros & kidMask;
+    r.ones = narrowed.ones & kidMask;
+    r.min = narrowed.min;
+    r.max = std::min(narrowed.max, kidMask);
+    r.normalize();
+    return refine(e->getKid(0), r);
+  }
+
+  case Expr::Concat: {
+    unsigned shift = e->getKid(1)->getWidth();
+    std::uint64_t lowMask = BitRange::mask(shift);
+    BitRange high(e->getKid(0)->getWidth());
+    high.zeros = narrowed.zeros >> shift;
+    high.ones = narrowed.ones >> shift;
+    high.min = narrowed.min >> shift;
+    high.max = narrowed.max >> shift;
+    high.normalize();
+    BitRange low = BitRange::known(shift, narrowed.zeros & lowMask,
+                                   narrowed.ones & lowMask);
+    if (narrowed.min >> shift == narrowed.max >> shift)
+      low = low.meet(BitRange::interval(shift, narrowed.min & lowMask,
+                                        narrowed.max & lowMask));
+    refine(e->getKid(0), high);
+    return refine(e->getKid(1), low);
+  }
+
+  case Expr::Extract: {
+    unsigned offset = cast<ExtractExpr>(e)->offset;
+    unsigned kidWidth = e->getKid(0)->getWidth();
+    if (kidWidth > 64)
+      return;
+    return refine(e->getKid(0),
+                  BitRange::known(kidWidth, narrowed.zeros << offset,
+                                  narrowed.ones << offset));
+  }
+
+  case Expr::Add: {
+    // Constants are on the left after canonicalization
+    BitRange c = eval(e->getKid(0));
+    if (!c.isConstant())
+      return;
+    if (narrowed.min >= c.min || narrowed.max < c.min)
+      refine(e->getKid(1), BitRange::interval(width, (narrowed.min - c.min) & m,
+                                              (narrowed.max - c.min) & m));
+    return;
+  }
+
+  case Expr::And:
+  case Expr::Or: {
+    bool isAnd = e->getKind() == Expr::And;
+    if (width == 1) {
+      // Both operands are known if the result is the absorbing value,
+      // otherwise one is known if the other is the neutral value
+      if (narrowed.isConstant() && narrowed.min != isAnd) {
+        BitRange a = eval(e->getKid(0)), b = eval(e->getKid(1));
+        if (a.isConstant() && a.min == isAnd)
+          refine(e->getKid(1), narrowed);
+        else if (b.isConstant() && b.min == isAnd)
+          refine(e->getKid(0), narrowed);
+        return;
+      }
+      refine(e->getKid(0), narrowed);
+      return refine(e->getKid(1), narrowed);
+    }
+    // Bits set in a conjunction are set in both operands, and bits clear in
+    // a disjunction are clear in both
+    BitRange r = isAnd ? BitRange::known(width, 0, narrowed.ones)
+                       : BitRange::known(width, narrowed.zeros, 0);
+    refine(e->getKid(0), r);
+    return refine(e->getKid(1), r);
+  }
+
+  case Expr::Eq: {
+    if (!narrowed.isConstant())
+      return;
+    const ref<Expr> &a = e->getKid(0), &b = e->getKid(1);
+    if (narrowed.min) {
+      refine(a, eval(b));
+      return refine(b, eval(a));
+    }
+    // Exclude a constant operand from the ends of the other's range
+    BitRange ca = eval(a), cb = eval(b);
+    for (unsigned i = 0; i != 2; ++i) {
+      const BitRange &c = i ? ca : cb;
+      const BitRange &x = i ? cb : ca;
+      if (!c.isConstant() || x.isWide())
+        continue;
+      if (x.min == c.min && x.max == c.min)
+        conflict = true;
+      else if (x.min == c.min)
+        refine(i ? b : a, BitRange::interval(x.width, c.min + 1, x.max));
+      else if (x.max == c.min)
+        refine(i ? b : a, BitRange::interval(x.width, x.min, c.min - 1));
+    }
+    return;
+  }
+
+  case Expr::Ult:
+  case Expr::Ule: {
+    if (!narrowed.isConstant())
+      return;
+    const ref<Expr> &a = e->getKid(0), &b = e->getKid(1);
+    BitRange ra = eval(a), rb = eval(b);
+    if (ra.isWide())
+      return;
+    std::uint64_t km = BitRange::mask(ra.width);
+    // a < b is !(b <= a), and a <= b is !(b < a)
+    bool strict = (e->getKind() == Expr::Ult) == (narrowed.min != 0);
+    const ref<Expr> &lo = narrowed.min ? a : b, &hi = narrowed.min ? b : a;
+    const BitRange &rlo = narrowed.min ? ra : rb, &rhi = narrowed.min ? rb : ra;
+    // lo < hi (if strict) or lo <= hi
+    if (strict && (rhi.max == 0 || rlo.min == km)) {
+      conflict = true;
+      return;
+    }
+    refine(lo, BitRange::interval(ra.width, 0, rhi.max - strict));
+    return refine(hi, BitRange::interval(ra.width, rlo.min + strict, km));
+  }
+
+  default:
+    return;
+  }
+}
+
+void BitRangeAnalysis::pickValues(
+    const std::vector<const Array *> &objects, bool high,
+    std::vector<std::vector<unsigned char>> &result) const {
+  result.clear();
+  for (const Array *array : objects) {
+    std::vector<unsigned char> data(array->size);
+    for (auto it = elements.lower_bound(element_ty(array, 0));
+         it != elements.end() && it->first.first == array; ++it) {
+      const BitRange &v = it->second;
+      if (it->first.second >= array->size)
+        continue;
+      // Search from the chosen end of the interval for a value that also
+      // matches the known bits
+      std::uint64_t value = high ? v.max : v.min;
+      for (unsigned i = 0; i != 256 && !v.contains(value); ++i)
+        high ? --value : ++value;
+      data[it->first.second] = static_cast<unsigned char>(value);
+    }
+    result.push_back(std::move(data));
+  }
+}
+
+/// BitRangeSolver decides queries by evaluating them over known bits and
+/// value ranges of the array elements, which are derived from the
+/// constraints. It looks for counterexamples among the extreme values of
+/// the ranges.
+class BitRangeSolver : public IncompleteSolver {
+  /// Propagates the constraints, and the assumption that expr has the given
+  /// value, into analysis. Returns false if they cannot all hold.
+  static bool propagate(BitRangeAnalysis &analysis, const Query &query,
+                        bool value);
+
+  /// Looks for an assignment to objects that satisfies the constraints and
+  /// gives expr the given value, and stores it in result.
+  static bool findAssignment(const Query &query, bool value,
+                             const std::vector<const Array *> &objects,
+                             std::vector<std::vector<unsigned char>> &result,
+                             bool &isImpossible);
+
+  static std::vector<const Array *> getObjects(const Query &query);
+
+public:
+  IncompleteSolver::PartialValidity computeValidity(const Query &) override;
+  IncompleteSolver::PartialValidity computeTruth(const Query &) override;
+  bool computeValue(const Query &, ref<Expr> &result) override;
+  bool computeInitialValues(const Query &,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char>> &values,
+                            bool &hasSolution) override;
+};
+
+bool BitRangeSolver::propagate(BitRangeAnalysis &analysis,
+                               const Query &query, bool value) {
+  // Narrowing one element may allow narrowing others through earlier
+  // constraints, so iterate a few times
+  for (unsigned round = 0; round != 4; ++round) {
+    analysis.changed = false;
+    for (const auto &constraint : query.constraints)
+      analysis.refine(constraint, BitRange::constant(1, 1));
+    if (query.expr->getWidth() == Expr::Bool)
+      analysis.refine(query.expr, BitRange::constant(1, value));
+    if (analysis.conflict)
+      return false;
+    if (!analysis.changed)
+      break;
+  }
+  return true;
+}
+
+std::vector<const Array *> BitRangeSolver::getObjects(const Query &query) {
+  std::vector<ref<Expr>> exprs(query.constraints.begin(),
+                               query.constraints.end());
+  exprs.push_back(query.expr);
+  std::vector<const Array *> objects;
+  findSymbolicObjects(exprs.begin(), exprs.end(), objects);
+  return objects;
+}
+
+bool BitRangeSolver::findAssignment(
+    const Query &query, bool value, const std::vector<const Array *> &objects,
+    std::vector<std::vector<unsigned char>> &result, bool &isImpossible) {
+  BitRangeAnalysis analysis;
+  isImpossible = !propagate(analysis, query, value);
+  if (isImpossible)
+    return false;
+
+  for (const Array *array : objects)
+    if (array->getRange() != Expr::Int8)
+      return false;
+
+  for (bool high : {false, true}) {
+    analysis.pickValues(objects, high, result);
+    Assignment assignment(objects, result);
+    if (!assignment.satisfies(query.constraints.begin(),
+                              query.constraints.end()))
+      continue;
+    ref<Expr> e = assignment.evaluate(query.expr);
+    if (query.expr->getWidth() != Expr::Bool ||
+        (isa<ConstantExpr>(e) && cast<ConstantExpr>(e)->isTrue() == value))
+      return true;
+  }
+  return false;
+}
+
+IncompleteSolver::PartialValidity
+BitRangeSolver::computeValidity(const Query &query) {
+  std::vector<const Array *> objects = getObjects(query);
+  std::vector<std::vector<unsigned char>> values;
+
+  bool isImpossible;
+  bool canBeTrue = findAssignment(query, true, objects, values, isImpossible);
+  if (isImpossible)
+    return MustBeFalse;
+  bool canBeFalse = findAssignment(query, false, objects, values, isImpossible);
+  if (isImpossible)
+    return MustBeTrue;
+
+  if (canBeTrue && canBeFalse)
+    return TrueOrFalse;
+  if (canBeTrue)
+    return MayBeTrue;
+  if (canBeFalse)
+    return MayBeFalse;
+  return None;
+}
+
+IncompleteSolver::PartialValidity
+BitRangeSolver::computeTruth(const Query &query) {
+  std::vector<const Array *> objects = getObjects(query);
+  std::vector<std::vector<unsigned char>> values;
+
+  bool isImpossible;
+  bool canBeFalse = findAssignment(query, false, objects, values, isImpossible);
+  if (isImpossible)
+    return MustBeTrue;
+  return canBeFalse ? MayBeFalse : None;
+}
+
+bool BitRangeSolver::computeValue(const Query &query, ref<Expr> &result) {
+  std::vector<const Array *> objects = getObjects(query);
+  std::vector<std::vector<unsigned char>> values;
+
+  bool isImpossible;
+  if (!findAssignment(query, true, objects, values, isImpossible))
+    return false;
+  Assignment assignment(objects, values);
+  result = assignment.evaluate(query.expr);
+  return isa<ConstantExpr>(result);
+}
+
+bool BitRangeSolver::computeInitialValues(
+    const Query &query, const std::vector<const Array *> &objects,
+    std::vector<std::vector<unsigned char>> &values, bool &hasSolution) {
+  // Find an assignment to all arrays of the query, not just those requested
+  std::vector<const Array *> all = getObjects(query);
+  for (const Array *array : objects)
+    if (std::find(all.begin(), all.end(), array) == all.end())
+      all.push_back(array);
+  std::vector<std::vector<unsigned char>> allValues;
+
+  bool isImpossible;
+  hasSolution = findAssignment(query, false, all, allValues, isImpossible);
+  if (isImpossible)
+    return true;
+  if (!hasSolution)
+    return false;
+
+  for (const Array *array : objects)
+    values.push_back(
+        allValues[std::find(all.begin(), all.end(), array) - all.begin()]);
+  return true;
+}
+
+} // namespace
+
+Solver *klee::createBitRangeSolver(Solver *s) {
+  return new Solver(new StagedSolverImpl(new BitRangeSolver(), s));
+}
@@ -48,13 +48,7 @@ private:
 
   struct CacheEntryHash {
     unsigned operator()(const CacheEntry &ce) const {
-      unsigned result = ce.query->hash();
-
-      for (auto const &constraint : ce.constraints) {
-        result ^= constraint->hash();
-      }
-
-      return result;
+      return ce.query->hash() ^ ce.constraints.hash();
     }
   };
 
@@ -71,6 +65,9 @@ public:
 
   bool computeValidity(const Query&, Solver::Validity &result);
   bool computeTruth(const Query&, bool &isValid);
+  bool computeMayBeTrue(const ConstraintSet &constraints,
+                        const std::vector<ref<Expr> > &exprs,
+                        std::vector<bool> &results);
   bool computeValue(const Query& query, ref<Expr> &result) {
     ++stats::queryCacheMisses;
     return solver->impl->computeValue(query, result);
@@ -241,6 +238,42 @@ bool CachingSolver::computeTruth(const Query& query,
   return true;
 }
 
+bool CachingSolver::computeMayBeTrue(const ConstraintSet &constraints,
+                                     const std::vector<ref<Expr> > &exprs,
+                                     std::vector<bool> &results) {
+  results.assign(exprs.size(), false);
+
+  // Answer what the cache knows, and pass the rest on as one batch
+  std::vector<ref<Expr> > missed;
+  std::vector<std::size_t> indices;
+  for (std::size_t i = 0; i < exprs.size(); ++i) {
+    IncompleteSolver::PartialValidity cachedResult;
+    if (cacheLookup(Query(constraints, exprs[i]), cachedResult) &&
+        cachedResult != IncompleteSolver::MayBeFalse) {
+      ++stats::queryCacheHits;
+      results[i] = (cachedResult != IncompleteSolver::MustBeFalse);
+    } else {
+      ++stats::queryCacheMisses;
+      missed.push_back(exprs[i]);
+      indices.push_back(i);
+    }
+  }
+  if (missed.empty())
+    return true;
+
+  std::vector<bool> missedResults;
+  if (!solver->impl->computeMayBeTrue(constraints, missed, missedResults))
+    return false;
+
+  for (std::size_t i = 0; i < missed.size(); ++i) {
+    results[indices[i]] = missedResults[i];
+    cacheInsert(Query(constraints, missed[i]),
+                missedResults[i] ? IncompleteSolver::MayBeTrue
+                                 : IncompleteSolver::MustBeFalse);
+  }
+  return true;
+}
+
 SolverImpl::SolverRunStatus CachingSolver::getOperationStatusCode() {
   return solver->impl->getOperationStatusCode();
 }
@@ -13,6 +13,7 @@
 #include "klee/Expr/Assignment.h"
 #include "klee/Expr/Constraints.h"
 #include "klee/Expr/Expr.h"
+#include "klee/Expr/ExprHashMap.h"
 #include "klee/Expr/ExprUtil.h"
 #include "klee/Expr/ExprVisitor.h"
 #include "klee/Support/OptionCategories.h"
@@ -68,7 +69,7 @@ class CexCachingSolver : public SolverImpl {
 
   Solver *solver;
   
-  MapOfSets<ref<Expr>, Assignment*> cache;
+  MapOfSets<ref<Expr>, Assignment *, util::ExprHash> cache;
   // memo table
   assignmentsTable_ty assignmentsTable;
 
@@ -90,6 +91,9 @@ public:
   
   bool computeTruth(const Query&, bool &isValid);
   bool computeValidity(const Query&, Solver::Validity &result);
+  bool computeMayBeTrue(const ConstraintSet &constraints,
+                        const std::vector<ref<Expr> > &exprs,
+                        std::vector<bool> &results);
   bool computeValue(const Query&, ref<Expr> &result);
   bool computeInitialValues(const Query&,
                             const std::vector<const Array*> &objects,
@@ -322,6 +326,45 @@ bool CexCachingSolver::computeTruth(const Query& query,
   return true;
 }
 
+bool CexCachingSolver::computeMayBeTrue(const ConstraintSet &constraints,
+                                        const std::vector<ref<Expr> > &exprs,
+                                        std::vector<bool> &results) {
+  TimerStatIncrementer t(stats::cexCacheTime);
+  results.assign(exprs.size(), false);
+
+  // An expression may be true iff constraints && expr has an assignment.
+  // Answer what the cache knows, and pass the rest on as one batch.
+  std::vector<KeyType> keys;
+  std::vector<ref<Expr> > missed;
+  std::vector<std::size_t> indices;
+  for (std::size_t i = 0; i < exprs.size(); ++i) {
+    KeyType key;
+    Assignment *a;
+    if (lookupAssignment(Query(constraints, Expr::createIsZero(exprs[i])), key,
+                         a)) {
+      results[i] = (a != 0);
+    } else {
+      keys.push_back(key);
+      missed.push_back(exprs[i]);
+      indices.push_back(i);
+    }
+  }
+  if (missed.empty())
+    return true;
+
+  std::vector<bool> missedResults;
+  if (!solver->impl->computeMayBeTrue(constraints, missed, missedResults))
+    return false;
+
+  // Only unsatisfiability can be cached, there is no assignment for the rest
+  for (std::size_t i = 0; i < missed.size(); ++i) {
+    results[indices[i]] = missedResults[i];
+    if (!missedResults[i])
+      cache.insert(keys[i], (Assignment *) 0);
+  }
+  return true;
+}
+
 bool CexCachingSolver::computeValue(const Query& query,
                                     ref<Expr> &result) {
   TimerStatIncrementer t(stats::cexCacheTime);
@@ -43,6 +43,15 @@ Solver *constructSolverChain(Solver *coreSolver,
   if (UseAssignmentValidatingSolver)
     solver = createAssignmentValidatingSolver(solver);
 
+  if (!PersistentQueryCache.empty()) {
+    solver = createPersistentCachingSolver(solver, PersistentQueryCache);
+    klee_message("Using persistent query cache %s\n",
+                 PersistentQueryCache.c_str());
+  }
+
+  if (UseBitRangeSolver)
+    solver = createBitRangeSolver(solver);
+
   if (UseFastCexSolver)
     solver = createFastCexSolver(solver);
 
@@ -19,6 +19,8 @@
 #include "llvm/Support/raw_ostream.h"
 
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace klee {
 
@@ -50,6 +52,34 @@ Solver *createCoreSolver(CoreSolverType cst) {
     klee_message("Not compiled with Z3 support");
     return NULL;
 #endif
+  case PORTFOLIO_SOLVER: {
+    std::vector<CoreSolverType> types(PortfolioSolvers.begin(),
+                                      PortfolioSolvers.end());
+    if (types.empty()) {
+#ifdef ENABLE_STP
+      types.push_back(STP_SOLVER);
+#endif
+#ifdef ENABLE_Z3
+      types.push_back(Z3_SOLVER);
+#endif
+#ifdef ENABLE_METASMT
+      types.push_back(METASMT_SOLVER);
+#endif
+    }
+
+    std::vector<std::pair<CoreSolverType, Solver *> > solvers;
+    for (auto type : types) {
+      assert(type != PORTFOLIO_SOLVER && "nested solver portfolio");
+      if (Solver *solver = createCoreSolver(type))
+        solvers.emplace_back(type, solver);
+    }
+    if (solvers.empty())
+      return NULL;
+    if (solvers.size() == 1)
+      return solvers.front().second;
+    klee_message("Using a portfolio of %zu solver backends", solvers.size());
+    return createPortfolioSolver(solvers);
+  }
   case NO_SOLVER:
     klee_message("Invalid solver");
     return NULL;
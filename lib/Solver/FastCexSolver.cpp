@@ -191,10 +191,15 @@ public:
     }
   }
 
+  // Values are 64 bits wide, so wider shifts leave nothing
   ValueRange binaryShiftLeft(unsigned bits) const {
+    if (bits >= 64)
+      return ValueRange(0);
     return ValueRange(m_min << bits, m_max << bits);
   }
   ValueRange binaryShiftRight(unsigned bits) const {
+    if (bits >= 64)
+      return ValueRange(0);
     return ValueRange(m_min >> bits, m_max >> bits);
   }
 
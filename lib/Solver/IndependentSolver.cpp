@@ -22,6 +22,7 @@
 #include <list>
 #include <map>
 #include <ostream>
+#include <set>
 #include <vector>
 
 using namespace klee;
@@ -262,6 +263,9 @@ inline llvm::raw_ostream &operator<<(llvm::raw_ostream &os,
 static std::list<IndependentElementSet>*
 getAllIndependentConstraintsSets(const Query &query) {
   std::list<IndependentElementSet> *factors = new std::list<IndependentElementSet>();
+
+  // The factor of the query expression absorbs all constraints it depends on
+  std::set<const Expr *> required;
   ConstantExpr *CE = dyn_cast<ConstantExpr>(query.expr);
   if (CE) {
     assert(CE && CE->isFalse() && "the expr should always be false and "
@@ -269,83 +273,33 @@ getAllIndependentConstraintsSets(const Query &query) {
   } else {
     ref<Expr> neg = Expr::createIsZero(query.expr);
     factors->push_back(IndependentElementSet(neg));
-  }
 
-  for (const auto &constraint : query.constraints) {
-    // iterate through all the previously separated constraints.  Until we
-    // actually return, factors is treated as a queue of expressions to be
-    // evaluated.  If the queue property isn't maintained, then the exprs
-    // could be returned in an order different from how they came it, negatively
-    // affecting later stages.
-    factors->push_back(IndependentElementSet(constraint));
+    std::vector< ref<Expr> > dependencies;
+    query.constraints.getIndependentConstraints(query.expr, dependencies);
+    for (const auto &constraint : dependencies) {
+      factors->front().add(IndependentElementSet(constraint));
+      required.insert(constraint.get());
+    }
   }
 
-  bool doneLoop = false;
-  do {
-    doneLoop = true;
-    std::list<IndependentElementSet> *done =
-        new std::list<IndependentElementSet>;
-    while (factors->size() > 0) {
-      IndependentElementSet current = factors->front();
-      factors->pop_front();
-      // This list represents the set of factors that are separate from current.
-      // Those that are not inserted into this list (queue) intersect with
-      // current.
-      std::list<IndependentElementSet> *keep =
-          new std::list<IndependentElementSet>;
-      while (factors->size() > 0) {
-        IndependentElementSet compare = factors->front();
-        factors->pop_front();
-        if (current.intersects(compare)) {
-          if (current.add(compare)) {
-            // Means that we have added (z=y)added to (x=y)
-            // Now need to see if there are any (z=?)'s
-            doneLoop = false;
-          }
-        } else {
-          keep->push_back(compare);
-        }
-      }
-      done->push_back(current);
-      delete factors;
-      factors = keep;
-    }
-    delete factors;
-    factors = done;
-  } while (!doneLoop);
+  // The constraint set maintains its partition into independent factors
+  std::vector< std::vector< ref<Expr> > > partition;
+  query.constraints.getIndependentFactors(partition);
+  for (const auto &factor : partition) {
+    if (required.count(factor.front().get()))
+      continue;
+    IndependentElementSet current(factor.front());
+    for (std::size_t i = 1; i < factor.size(); ++i)
+      current.add(IndependentElementSet(factor[i]));
+    factors->push_back(current);
+  }
 
   return factors;
 }
 
-static 
-IndependentElementSet getIndependentConstraints(const Query& query,
-                                                std::vector< ref<Expr> > &result) {
-  IndependentElementSet eltsClosure(query.expr);
-  std::vector< std::pair<ref<Expr>, IndependentElementSet> > worklist;
-
-  for (const auto &constraint : query.constraints)
-    worklist.push_back(
-        std::make_pair(constraint, IndependentElementSet(constraint)));
-
-  // XXX This should be more efficient (in terms of low level copy stuff).
-  bool done = false;
-  do {
-    done = true;
-    std::vector< std::pair<ref<Expr>, IndependentElementSet> > newWorklist;
-    for (std::vector< std::pair<ref<Expr>, IndependentElementSet> >::iterator
-           it = worklist.begin(), ie = worklist.end(); it != ie; ++it) {
-      if (it->second.intersects(eltsClosure)) {
-        if (eltsClosure.add(it->second))
-          done = false;
-        result.push_back(it->first);
-        // Means that we have added (z=y)added to (x=y)
-        // Now need to see if there are any (z=?)'s
-      } else {
-        newWorklist.push_back(*it);
-      }
-    }
-    worklist.swap(newWorklist);
-  } while (!done);
+static void getIndependentConstraints(const Query &query,
+                                      std::vector<ref<Expr> > &result) {
+  query.constraints.getIndependentConstraints(query.expr, result);
 
   KLEE_DEBUG(
     std::set< ref<Expr> > reqset(result.begin(), result.end());
@@ -358,11 +312,7 @@ IndependentElementSet getIndependentConstraints(const Query& query,
       errs() << " " << (reqset.count(constraint) ? "(required)" : "(independent)") << "\n";
       errs() << "\telts: " << IndependentElementSet(constraint) << "\n";
     }
-    errs() << "elts closure: " << eltsClosure << "\n";
  );
-
-
-  return eltsClosure;
 }
 
 
@@ -397,6 +347,9 @@ public:
 
   bool computeTruth(const Query&, bool &isValid);
   bool computeValidity(const Query&, Solver::Validity &result);
+  bool computeMayBeTrue(const ConstraintSet &constraints,
+                        const std::vector<ref<Expr> > &exprs,
+                        std::vector<bool> &results);
   bool computeValue(const Query&, ref<Expr> &result);
   bool computeInitialValues(const Query& query,
                             const std::vector<const Array*> &objects,
@@ -410,8 +363,7 @@ public:
 bool IndependentSolver::computeValidity(const Query& query,
                                         Solver::Validity &result) {
   std::vector< ref<Expr> > required;
-  IndependentElementSet eltsClosure =
-    getIndependentConstraints(query, required);
+  getIndependentConstraints(query, required);
   ConstraintSet tmp(required);
   return solver->impl->computeValidity(Query(tmp, query.expr), 
                                        result);
@@ -419,17 +371,52 @@ bool IndependentSolver::computeValidity(const Query& query,
 
 bool IndependentSolver::computeTruth(const Query& query, bool &isValid) {
   std::vector< ref<Expr> > required;
-  IndependentElementSet eltsClosure = 
-    getIndependentConstraints(query, required);
+  getIndependentConstraints(query, required);
   ConstraintSet tmp(required);
   return solver->impl->computeTruth(Query(tmp, query.expr), 
                                     isValid);
 }
 
+bool IndependentSolver::computeMayBeTrue(const ConstraintSet &constraints,
+                                         const std::vector<ref<Expr> > &exprs,
+                                         std::vector<bool> &results) {
+  // Expressions over the same variables, like the cases of a switch, depend
+  // on the same factors, so each group of them is forwarded as one batch.
+  std::vector<std::vector<ref<Expr> > > groupConstraints;
+  std::vector<std::vector<std::size_t> > groupMembers;
+  std::map<std::vector<const Expr *>, std::size_t> groupOf;
+  for (std::size_t i = 0; i < exprs.size(); ++i) {
+    std::vector<ref<Expr> > required;
+    getIndependentConstraints(Query(constraints, exprs[i]), required);
+    std::vector<const Expr *> key;
+    for (const auto &constraint : required)
+      key.push_back(constraint.get());
+    auto group = groupOf.insert(std::make_pair(key, groupMembers.size()));
+    if (group.second) {
+      groupConstraints.push_back(required);
+      groupMembers.emplace_back();
+    }
+    groupMembers[group.first->second].push_back(i);
+  }
+
+  results.assign(exprs.size(), false);
+  for (std::size_t group = 0; group < groupMembers.size(); ++group) {
+    ConstraintSet tmp(groupConstraints[group]);
+    std::vector<ref<Expr> > groupExprs;
+    for (auto i : groupMembers[group])
+      groupExprs.push_back(exprs[i]);
+    std::vector<bool> groupResults;
+    if (!solver->impl->computeMayBeTrue(tmp, groupExprs, groupResults))
+      return false;
+    for (std::size_t i = 0; i < groupResults.size(); ++i)
+      results[groupMembers[group][i]] = groupResults[i];
+  }
+  return true;
+}
+
 bool IndependentSolver::computeValue(const Query& query, ref<Expr> &result) {
   std::vector< ref<Expr> > required;
-  IndependentElementSet eltsClosure = 
-    getIndependentConstraints(query, required);
+  getIndependentConstraints(query, required);
   ConstraintSet tmp(required);
   return solver->impl->computeValue(Query(tmp, query.expr), result);
 }
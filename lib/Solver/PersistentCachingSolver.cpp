@@ -0,0 +1,498 @@
+//===-- PersistentCachingSolver.cpp ---------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Solver/Solver.h"
+
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/Expr.h"
+#include "klee/Solver/SolverCmdLine.h"
+#include "klee/Solver/SolverImpl.h"
+#include "klee/Solver/SolverStats.h"
+#include "klee/Support/ErrorHandling.h"
+#include "klee/System/Time.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/Support/Errno.h"
+#include "llvm/Support/MD5.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace klee;
+
+namespace {
+
+/// A 128-bit hash identifying a query independent of array names.
+struct QueryKey {
+  uint64_t low, high;
+
+  bool operator==(const QueryKey &other) const {
+    return low == other.low && high == other.high;
+  }
+};
+
+struct QueryKeyHash {
+  std::size_t operator()(const QueryKey &key) const { return key.low; }
+};
+
+enum class QueryKind : uint8_t { Truth, InitialValues };
+
+/// Hashes the structure of a query. Expressions, update nodes and arrays
+/// are numbered in the order they are first encountered, so that two queries
+/// that only differ in array names (alpha-renaming) get the same key.
+///
+/// Every node is hashed as one record, made of a tag for its type, the
+/// number of fields and the fields, so that different sequences of records
+/// never hash the same byte stream.
+class QueryHasher {
+  enum class Record : uint8_t { Kind, Array, Update, Expr, Query, Objects };
+
+  llvm::MD5 md5;
+  std::unordered_map<const Expr *, uint64_t> exprIds;
+  std::unordered_map<const UpdateNode *, uint64_t> updateIds;
+  std::unordered_map<const Array *, uint64_t> arrayIds;
+
+  void add(Record tag, const std::vector<uint64_t> &fields) {
+    uint8_t tagByte = static_cast<uint8_t>(tag);
+    md5.update(llvm::ArrayRef<uint8_t>(&tagByte, 1));
+    uint64_t length = fields.size();
+    md5.update(llvm::ArrayRef<uint8_t>(reinterpret_cast<uint8_t *>(&length),
+                                       sizeof(length)));
+    md5.update(llvm::ArrayRef<uint8_t>(
+        reinterpret_cast<const uint8_t *>(fields.data()),
+        fields.size() * sizeof(uint64_t)));
+  }
+
+  uint64_t visitArray(const Array *array) {
+    auto it = arrayIds.find(array);
+    if (it != arrayIds.end())
+      return it->second;
+
+    std::vector<uint64_t> fields{array->size, array->domain, array->range};
+    for (auto const &value : array->constantValues)
+      fields.push_back(visit(value));
+    add(Record::Array, fields);
+    uint64_t id = arrayIds.size();
+    arrayIds[array] = id;
+    return id;
+  }
+
+  uint64_t visitUpdates(const UpdateNode *head) {
+    // Hash the oldest updates first and iteratively, update lists get long
+    std::vector<const UpdateNode *> pending;
+    for (const UpdateNode *un = head; un && !updateIds.count(un);
+         un = un->next.get())
+      pending.push_back(un);
+
+    for (auto it = pending.rbegin(), ie = pending.rend(); it != ie; ++it) {
+      const UpdateNode *un = *it;
+      uint64_t next = un->next ? updateIds[un->next.get()] + 1 : 0;
+      uint64_t index = visit(un->index);
+      add(Record::Update, {next, index, visit(un->value)});
+      uint64_t id = updateIds.size();
+      updateIds[un] = id;
+    }
+    return head ? updateIds[head] + 1 : 0;
+  }
+
+public:
+  explicit QueryHasher(QueryKind kind) {
+    add(Record::Kind, {static_cast<uint64_t>(kind)});
+  }
+
+  uint64_t visit(const ref<Expr> &e) {
+    auto it = exprIds.find(e.get());
+    if (it != exprIds.end())
+      return it->second;
+
+    // Kids are hashed before the node itself
+    std::vector<uint64_t> kids;
+    uint64_t array = 0, updates = 0;
+    if (const ReadExpr *re = dyn_cast<ReadExpr>(e)) {
+      array = visitArray(re->updates.root);
+      updates = visitUpdates(re->updates.head.get());
+    }
+    for (unsigned i = 0, n = e->getNumKids(); i != n; ++i)
+      kids.push_back(visit(e->getKid(i)));
+
+    std::vector<uint64_t> fields{static_cast<uint64_t>(e->getKind()),
+                                 e->getWidth()};
+    if (const ConstantExpr *ce = dyn_cast<ConstantExpr>(e)) {
+      const llvm::APInt &value = ce->getAPValue();
+      fields.insert(fields.end(), value.getRawData(),
+                    value.getRawData() + value.getNumWords());
+    } else if (const ExtractExpr *ee = dyn_cast<ExtractExpr>(e)) {
+      fields.push_back(ee->offset);
+    } else if (isa<ReadExpr>(e)) {
+      fields.push_back(array);
+      fields.push_back(updates);
+    }
+    fields.insert(fields.end(), kids.begin(), kids.end());
+    add(Record::Expr, fields);
+
+    uint64_t id = exprIds.size();
+    exprIds[e.get()] = id;
+    return id;
+  }
+
+  void visit(const Query &query) {
+    std::vector<uint64_t> fields;
+    for (auto const &constraint : query.constraints)
+      fields.push_back(visit(constraint));
+    fields.push_back(visit(query.expr));
+    add(Record::Query, fields);
+  }
+
+  void visit(const std::vector<const Array *> &objects) {
+    std::vector<uint64_t> fields;
+    for (auto object : objects)
+      fields.push_back(visitArray(object));
+    add(Record::Objects, fields);
+  }
+
+  QueryKey getKey() {
+    llvm::MD5::MD5Result result;
+    md5.final(result);
+    return {result.low(), result.high()};
+  }
+};
+
+/// Append-only file of query results, mapped into memory for lookups.
+///
+/// The file starts with a magic string, followed by records of the form
+///   uint8 marker[4], uint32 length, uint32 checksum,
+///   QueryKey key, uint8 data[length - sizeof(QueryKey)]
+/// where the checksum covers the key and the data. Records are only ever
+/// appended, under an exclusive flock() so that concurrent KLEE processes do
+/// not interleave their writes. Records written by other processes are picked
+/// up when a lookup misses, at most once a second. Records left incomplete by
+/// a process that died while writing are skipped, by searching for the next
+/// marker. Records are never removed, so the file only grows, up to
+/// --persistent-query-cache-max-size.
+class PersistentQueryCache {
+  static constexpr char Magic[8] = {'K', 'L', 'E', 'E', 'Q', 'C', '0', '2'};
+  static constexpr uint8_t Marker[4] = {'K', 'Q', 'R', 0xA5};
+
+  struct Header {
+    uint8_t marker[4];
+    uint32_t length;
+    uint32_t checksum;
+  };
+
+  /// Location of the key and data of a record in the mapping
+  struct Entry {
+    std::size_t begin;
+    uint32_t length;
+  };
+
+  std::string path;
+  int fd;
+  const uint8_t *mapping;
+  std::size_t mappedSize;
+  std::size_t indexedSize;
+  /// Size of the file when it was last checked, including own records
+  std::size_t fileSize;
+  /// Time of the last check for records of other processes
+  time::Point lastRefresh;
+  std::unordered_map<QueryKey, Entry, QueryKeyHash> index;
+
+  static uint32_t checksum(llvm::ArrayRef<uint8_t> bytes);
+  void refresh();
+
+public:
+  explicit PersistentQueryCache(const std::string &path);
+  ~PersistentQueryCache();
+
+  /// Returns the data stored for key, or an empty ArrayRef if there is none.
+  llvm::ArrayRef<uint8_t> lookup(const QueryKey &key);
+  void insert(const QueryKey &key, llvm::ArrayRef<uint8_t> data);
+};
+
+constexpr char PersistentQueryCache::Magic[8];
+constexpr uint8_t PersistentQueryCache::Marker[4];
+
+uint32_t PersistentQueryCache::checksum(llvm::ArrayRef<uint8_t> bytes) {
+  llvm::MD5 md5;
+  md5.update(bytes);
+  llvm::MD5::MD5Result result;
+  md5.final(result);
+  return static_cast<uint32_t>(result.low());
+}
+
+PersistentQueryCache::PersistentQueryCache(const std::string &_path)
+    : path(_path), mapping(nullptr), mappedSize(0),
+      indexedSize(sizeof(Magic)), fileSize(0) {
+  fd = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (fd < 0)
+    klee_error("Cannot open persistent query cache %s: %s", path.c_str(),
+               llvm::sys::StrError(errno).c_str());
+
+  flock(fd, LOCK_EX);
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size == 0 &&
+      write(fd, Magic, sizeof(Magic)) != sizeof(Magic))
+    klee_error("Cannot initialise persistent query cache %s: %s",
+               path.c_str(), llvm::sys::StrError(errno).c_str());
+  flock(fd, LOCK_UN);
+
+  refresh();
+  if (mappedSize < sizeof(Magic) ||
+      std::memcmp(mapping, Magic, sizeof(Magic)) != 0)
+    klee_error("%s is not a persistent query cache", path.c_str());
+}
+
+PersistentQueryCache::~PersistentQueryCache() {
+  if (mapping)
+    munmap(const_cast<uint8_t *>(mapping), mappedSize);
+  close(fd);
+}
+
+void PersistentQueryCache::refresh() {
+  lastRefresh = time::getWallTime();
+  struct stat st;
+  if (fstat(fd, &st) < 0)
+    return;
+  fileSize = st.st_size;
+  if (fileSize <= mappedSize)
+    return;
+
+  // Writers hold the lock exclusively, so all records seen under the shared
+  // lock are complete unless their writer died
+  flock(fd, LOCK_SH);
+  if (fstat(fd, &st) < 0 ||
+      static_cast<std::size_t>(st.st_size) <= mappedSize) {
+    flock(fd, LOCK_UN);
+    return;
+  }
+
+  if (mapping)
+    munmap(const_cast<uint8_t *>(mapping), mappedSize);
+  mappedSize = st.st_size;
+  void *p = mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+  flock(fd, LOCK_UN);
+  if (p == MAP_FAILED)
+    klee_error("Cannot map persistent query cache %s: %s", path.c_str(),
+               llvm::sys::StrError(errno).c_str());
+  mapping = static_cast<const uint8_t *>(p);
+
+  const uint8_t *end = mapping + mappedSize;
+  while (indexedSize + sizeof(Header) <= mappedSize) {
+    Header header;
+    std::memcpy(&header, mapping + indexedSize, sizeof(header));
+    std::size_t begin = indexedSize + sizeof(header);
+    if (std::memcmp(header.marker, Marker, sizeof(Marker)) == 0 &&
+        header.length >= sizeof(QueryKey) &&
+        header.length <= mappedSize - begin &&
+        checksum(llvm::ArrayRef<uint8_t>(mapping + begin, header.length)) ==
+            header.checksum) {
+      QueryKey key;
+      std::memcpy(&key, mapping + begin, sizeof(key));
+      index[key] = {begin, header.length};
+      indexedSize = begin + header.length;
+      continue;
+    }
+
+    // A corrupt record, continue with the next one
+    const uint8_t *next = std::search(mapping + indexedSize + 1, end, Marker,
+                                      Marker + sizeof(Marker));
+    indexedSize = next - mapping;
+  }
+}
+
+llvm::ArrayRef<uint8_t> PersistentQueryCache::lookup(const QueryKey &key) {
+  auto it = index.find(key);
+  if (it == index.end()) {
+    if (time::getWallTime() - lastRefresh < time::seconds(1))
+      return {};
+    refresh();
+    it = index.find(key);
+    if (it == index.end())
+      return {};
+  }
+
+  return llvm::ArrayRef<uint8_t>(mapping + it->second.begin + sizeof(QueryKey),
+                                 it->second.length - sizeof(QueryKey));
+}
+
+void PersistentQueryCache::insert(const QueryKey &key,
+                                  llvm::ArrayRef<uint8_t> data) {
+  Header header;
+  std::memcpy(header.marker, Marker, sizeof(Marker));
+  header.length = sizeof(QueryKey) + data.size();
+  std::size_t maxSize = std::size_t(PersistentQueryCacheMaxSize) << 20;
+  if (maxSize && fileSize + sizeof(header) + header.length > maxSize) {
+    klee_warning_once(this, "Persistent query cache %s is full, not adding "
+                      "more results", path.c_str());
+    return;
+  }
+
+  std::vector<uint8_t> record(sizeof(header) + header.length);
+  uint8_t *payload = record.data() + sizeof(header);
+  std::memcpy(payload, &key, sizeof(key));
+  std::copy(data.begin(), data.end(), payload + sizeof(key));
+  header.checksum =
+      checksum(llvm::ArrayRef<uint8_t>(payload, header.length));
+  std::memcpy(record.data(), &header, sizeof(header));
+
+  // A single write of the whole record, so readers never see it interleaved
+  flock(fd, LOCK_EX);
+  ssize_t written = write(fd, record.data(), record.size());
+  flock(fd, LOCK_UN);
+  if (written > 0)
+    fileSize += written;
+  if (written != static_cast<ssize_t>(record.size()))
+    klee_warning("Cannot write to persistent query cache %s: %s",
+                 path.c_str(), llvm::sys::StrError(errno).c_str());
+}
+
+class PersistentCachingSolver : public SolverImpl {
+private:
+  Solver *solver;
+  PersistentQueryCache cache;
+
+  bool lookupTruth(const Query &query, bool &isValid);
+  void insertTruth(const Query &query, bool isValid);
+
+public:
+  PersistentCachingSolver(Solver *s, const std::string &path)
+      : solver(s), cache(path) {}
+  ~PersistentCachingSolver() { delete solver; }
+
+  bool computeValidity(const Query &, Solver::Validity &result);
+  bool computeTruth(const Query &, bool &isValid);
+  bool computeValue(const Query &query, ref<Expr> &result) {
+    return solver->impl->computeValue(query, result);
+  }
+  bool computeInitialValues(const Query &query,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char> > &values,
+                            bool &hasSolution);
+  SolverRunStatus getOperationStatusCode();
+  char *getConstraintLog(const Query &);
+  void setCoreSolverTimeout(time::Span timeout);
+};
+
+bool PersistentCachingSolver::lookupTruth(const Query &query, bool &isValid) {
+  QueryHasher hasher(QueryKind::Truth);
+  hasher.visit(query);
+  llvm::ArrayRef<uint8_t> data = cache.lookup(hasher.getKey());
+  if (data.size() != 1)
+    return false;
+  isValid = data[0];
+  return true;
+}
+
+void PersistentCachingSolver::insertTruth(const Query &query, bool isValid) {
+  QueryHasher hasher(QueryKind::Truth);
+  hasher.visit(query);
+  uint8_t data = isValid;
+  cache.insert(hasher.getKey(), data);
+}
+
+bool PersistentCachingSolver::computeValidity(const Query &query,
+                                              Solver::Validity &result) {
+  bool isTrue, isFalse;
+  if (lookupTruth(query, isTrue) && lookupTruth(query.negateExpr(), isFalse)) {
+    ++stats::queryPersistentCacheHits;
+    result = isTrue ? Solver::True : isFalse ? Solver::False : Solver::Unknown;
+    return true;
+  }
+
+  ++stats::queryPersistentCacheMisses;
+  if (!solver->impl->computeValidity(query, result))
+    return false;
+  insertTruth(query, result == Solver::True);
+  insertTruth(query.negateExpr(), result == Solver::False);
+  return true;
+}
+
+bool PersistentCachingSolver::computeTruth(const Query &query, bool &isValid) {
+  if (lookupTruth(query, isValid)) {
+    ++stats::queryPersistentCacheHits;
+    return true;
+  }
+
+  ++stats::queryPersistentCacheMisses;
+  if (!solver->impl->computeTruth(query, isValid))
+    return false;
+  insertTruth(query, isValid);
+  return true;
+}
+
+bool PersistentCachingSolver::computeInitialValues(
+    const Query &query, const std::vector<const Array *> &objects,
+    std::vector<std::vector<unsigned char> > &values, bool &hasSolution) {
+  QueryHasher hasher(QueryKind::InitialValues);
+  hasher.visit(query);
+  hasher.visit(objects);
+  QueryKey key = hasher.getKey();
+
+  // The data is the hasSolution flag, followed by the values of all objects
+  // if there is a solution
+  std::size_t valuesSize = 0;
+  for (auto object : objects)
+    valuesSize += object->size;
+
+  llvm::ArrayRef<uint8_t> data = cache.lookup(key);
+  if (data.size() == 1 || data.size() == 1 + valuesSize) {
+    ++stats::queryPersistentCacheHits;
+    hasSolution = data[0];
+    if (hasSolution) {
+      const uint8_t *pos = data.data() + 1;
+      values.reserve(objects.size());
+      for (auto object : objects) {
+        values.emplace_back(pos, pos + object->size);
+        pos += object->size;
+      }
+    }
+    return true;
+  }
+
+  ++stats::queryPersistentCacheMisses;
+  if (!solver->impl->computeInitialValues(query, objects, values,
+                                          hasSolution))
+    return false;
+
+  std::vector<uint8_t> result(1, hasSolution);
+  if (hasSolution) {
+    result.reserve(1 + valuesSize);
+    for (auto const &value : values)
+      result.insert(result.end(), value.begin(), value.end());
+  }
+  cache.insert(key, result);
+  return true;
+}
+
+SolverImpl::SolverRunStatus PersistentCachingSolver::getOperationStatusCode() {
+  return solver->impl->getOperationStatusCode();
+}
+
+char *PersistentCachingSolver::getConstraintLog(const Query &query) {
+  return solver->impl->getConstraintLog(query);
+}
+
+void PersistentCachingSolver::setCoreSolverTimeout(time::Span timeout) {
+  solver->impl->setCoreSolverTimeout(timeout);
+}
+
+} // namespace
+
+Solver *klee::createPersistentCachingSolver(Solver *s,
+                                            const std::string &path) {
+  return new Solver(new PersistentCachingSolver(s, path));
+}
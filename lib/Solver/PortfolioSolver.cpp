@@ -0,0 +1,344 @@
+//===-- PortfolioSolver.cpp -----------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Expr/Assignment.h"
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/ExprUtil.h"
+#include "klee/Solver/Solver.h"
+#include "klee/Solver/SolverImpl.h"
+#include "klee/Solver/SolverStats.h"
+#include "klee/Statistics/TimerStatIncrementer.h"
+#include "klee/Support/ErrorHandling.h"
+
+#include "llvm/Support/Errno.h"
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace klee {
+
+/// Races several core solvers against each other. As neither the expression
+/// library nor the solvers are thread-safe, each backend runs in a forked
+/// copy of the process and reports its answer through a pipe. Whatever a
+/// backend learns while answering a query is therefore lost with the child.
+class PortfolioSolver : public SolverImpl {
+private:
+  std::vector<std::pair<CoreSolverType, Solver *> > solvers;
+  SolverRunStatus runStatusCode;
+
+  /// Result of one backend as sent over the pipe, followed by the values of
+  /// all requested objects if it found a solution
+  struct Response {
+    SolverRunStatus status;
+    bool hasSolution;
+  };
+
+  static Statistic *getWinStatistic(CoreSolverType type);
+  static bool readAll(int fd, std::vector<unsigned char> &buffer);
+  static void writeAll(int fd, const unsigned char *data, std::size_t size);
+
+  bool runPortfolio(const Query &query,
+                    const std::vector<const Array *> *objects,
+                    std::vector<std::vector<unsigned char> > *values,
+                    bool &hasSolution);
+
+public:
+  explicit PortfolioSolver(
+      const std::vector<std::pair<CoreSolverType, Solver *> > &_solvers)
+      : solvers(_solvers), runStatusCode(SOLVER_RUN_STATUS_FAILURE) {}
+  ~PortfolioSolver();
+
+  bool computeTruth(const Query &, bool &isValid);
+  bool computeValue(const Query &, ref<Expr> &result);
+  bool computeInitialValues(const Query &,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char> > &values,
+                            bool &hasSolution);
+  SolverRunStatus getOperationStatusCode();
+  char *getConstraintLog(const Query &);
+  void setCoreSolverTimeout(time::Span timeout);
+};
+
+PortfolioSolver::~PortfolioSolver() {
+  klee_message("Solver portfolio wins: STP %llu, metaSMT %llu, Z3 %llu",
+               (unsigned long long)stats::portfolioWinsSTP.getValue(),
+               (unsigned long long)stats::portfolioWinsMetaSMT.getValue(),
+               (unsigned long long)stats::portfolioWinsZ3.getValue());
+  for (auto &solver : solvers)
+    delete solver.second;
+}
+
+Statistic *PortfolioSolver::getWinStatistic(CoreSolverType type) {
+  switch (type) {
+  case STP_SOLVER:
+    return &stats::portfolioWinsSTP;
+  case METASMT_SOLVER:
+    return &stats::portfolioWinsMetaSMT;
+  case Z3_SOLVER:
+    return &stats::portfolioWinsZ3;
+  default:
+    return nullptr;
+  }
+}
+
+bool PortfolioSolver::readAll(int fd, std::vector<unsigned char> &buffer) {
+  unsigned char chunk[4096];
+  for (;;) {
+    ssize_t n = read(fd, chunk, sizeof(chunk));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      return false;
+    if (n == 0)
+      return true;
+    buffer.insert(buffer.end(), chunk, chunk + n);
+  }
+}
+
+void PortfolioSolver::writeAll(int fd, const unsigned char *data,
+                               std::size_t size) {
+  while (size) {
+    ssize_t n = write(fd, data, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      _exit(1);
+    data += n;
+    size -= n;
+  }
+}
+
+bool PortfolioSolver::runPortfolio(
+    const Query &query, const std::vector<const Array *> *objects,
+    std::vector<std::vector<unsigned char> > *values, bool &hasSolution) {
+  TimerStatIncrementer t(stats::queryTime);
+  ++stats::queries;
+  if (objects)
+    ++stats::queryCounterexamples;
+
+  fflush(stdout);
+  fflush(stderr);
+
+  struct Child {
+    pid_t pid;
+    int fd;
+    std::size_t solver;
+  };
+  std::vector<Child> children;
+
+  for (std::size_t i = 0; i < solvers.size(); ++i) {
+    int fds[2];
+    if (pipe(fds) < 0) {
+      klee_warning("pipe failed (for solver portfolio) - %s",
+                   llvm::sys::StrError(errno).c_str());
+      continue;
+    }
+
+    pid_t pid = fork();
+    if (pid == -1) {
+      klee_warning("fork failed (for solver portfolio) - %s",
+                   llvm::sys::StrError(errno).c_str());
+      close(fds[0]);
+      close(fds[1]);
+      continue;
+    }
+
+    // - child (solver)
+    if (pid == 0) {
+      close(fds[0]);
+      for (auto &child : children)
+        close(child.fd);
+
+      SolverImpl *impl = solvers[i].second->impl;
+      Response response;
+      std::vector<std::vector<unsigned char> > result;
+      bool success;
+      if (objects) {
+        success = impl->computeInitialValues(query, *objects, result,
+                                             response.hasSolution);
+      } else {
+        bool isValid = false;
+        success = impl->computeTruth(query, isValid);
+        response.hasSolution = !isValid;
+      }
+      response.status =
+          success ? impl->getOperationStatusCode() : SOLVER_RUN_STATUS_FAILURE;
+      if (success && response.status != SOLVER_RUN_STATUS_SUCCESS_SOLVABLE &&
+          response.status != SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE) {
+        // Not every backend tracks its status, but success is definitive
+        response.status = response.hasSolution
+                              ? SOLVER_RUN_STATUS_SUCCESS_SOLVABLE
+                              : SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE;
+      }
+
+      writeAll(fds[1], reinterpret_cast<const unsigned char *>(&response),
+               sizeof(response));
+      if (success && response.hasSolution) {
+        for (auto &data : result)
+          writeAll(fds[1], data.data(), data.size());
+      }
+      _exit(0);
+    }
+
+    // - parent
+    close(fds[1]);
+    children.push_back({pid, fds[0], i});
+  }
+
+  if (children.empty()) {
+    runStatusCode = SOLVER_RUN_STATUS_FORK_FAILED;
+    return false;
+  }
+
+  runStatusCode = SOLVER_RUN_STATUS_FAILURE;
+  bool found = false;
+  std::vector<pollfd> pending;
+  for (auto &child : children)
+    pending.push_back({child.fd, POLLIN, 0});
+
+  while (!found && !pending.empty()) {
+    int res = poll(pending.data(), pending.size(), -1);
+    if (res < 0 && errno == EINTR)
+      continue;
+    if (res < 0) {
+      klee_warning("poll failed (for solver portfolio) - %s",
+                   llvm::sys::StrError(errno).c_str());
+      break;
+    }
+
+    for (auto it = pending.begin(); it != pending.end();) {
+      if (!it->revents) {
+        ++it;
+        continue;
+      }
+
+      std::vector<unsigned char> buffer;
+      bool complete = readAll(it->fd, buffer);
+      std::size_t solver = 0;
+      for (auto &child : children)
+        if (child.fd == it->fd)
+          solver = child.solver;
+      it = pending.erase(it);
+
+      // A crashed backend closes the pipe without sending a response
+      if (!complete || buffer.size() < sizeof(Response))
+        continue;
+      Response response;
+      std::copy(buffer.begin(), buffer.begin() + sizeof(Response),
+                reinterpret_cast<unsigned char *>(&response));
+
+      if (response.status == SOLVER_RUN_STATUS_TIMEOUT)
+        runStatusCode = SOLVER_RUN_STATUS_TIMEOUT;
+      if (response.status != SOLVER_RUN_STATUS_SUCCESS_SOLVABLE &&
+          response.status != SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE)
+        continue;
+
+      if (objects && response.hasSolution) {
+        std::size_t size = sizeof(Response);
+        for (auto object : *objects)
+          size += object->size;
+        if (buffer.size() != size)
+          continue;
+
+        auto pos = buffer.begin() + sizeof(Response);
+        values->reserve(objects->size());
+        for (auto object : *objects) {
+          values->emplace_back(pos, pos + object->size);
+          pos += object->size;
+        }
+      }
+
+      hasSolution = response.hasSolution;
+      runStatusCode = response.status;
+      if (Statistic *wins = getWinStatistic(solvers[solver].first))
+        ++*wins;
+      found = true;
+      break;
+    }
+  }
+
+  // Cancel the backends that are still running
+  for (auto &child : children) {
+    if (found)
+      kill(child.pid, SIGKILL);
+    close(child.fd);
+    while (waitpid(child.pid, nullptr, 0) < 0 && errno == EINTR)
+      ;
+  }
+
+  if (!found)
+    return false;
+
+  if (hasSolution)
+    ++stats::queriesInvalid;
+  else
+    ++stats::queriesValid;
+  return true;
+}
+
+bool PortfolioSolver::computeTruth(const Query &query, bool &isValid) {
+  bool hasSolution = false;
+  if (!runPortfolio(query, /*objects=*/nullptr, /*values=*/nullptr,
+                    hasSolution))
+    return false;
+  isValid = !hasSolution;
+  return true;
+}
+
+bool PortfolioSolver::computeValue(const Query &query, ref<Expr> &result) {
+  std::vector<const Array *> objects;
+  std::vector<std::vector<unsigned char> > values;
+  bool hasSolution;
+
+  // Find the object used in the expression, and compute an assignment
+  // for them.
+  findSymbolicObjects(query.expr, objects);
+  if (!computeInitialValues(query.withFalse(), objects, values, hasSolution))
+    return false;
+  assert(hasSolution && "state has invalid constraint set");
+
+  // Evaluate the expression with the computed assignment.
+  Assignment a(objects, values);
+  result = a.evaluate(query.expr);
+
+  return true;
+}
+
+bool PortfolioSolver::computeInitialValues(
+    const Query &query, const std::vector<const Array *> &objects,
+    std::vector<std::vector<unsigned char> > &values, bool &hasSolution) {
+  return runPortfolio(query, &objects, &values, hasSolution);
+}
+
+SolverImpl::SolverRunStatus PortfolioSolver::getOperationStatusCode() {
+  return runStatusCode;
+}
+
+char *PortfolioSolver::getConstraintLog(const Query &query) {
+  return solvers.front().second->impl->getConstraintLog(query);
+}
+
+void PortfolioSolver::setCoreSolverTimeout(time::Span timeout) {
+  for (auto &solver : solvers)
+    solver.second->impl->setCoreSolverTimeout(timeout);
+}
+
+Solver *createPortfolioSolver(
+    const std::vector<std::pair<CoreSolverType, Solver *> > &solvers) {
+  return new Solver(new PortfolioSolver(solvers));
+}
+}
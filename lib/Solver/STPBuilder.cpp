@@ -13,6 +13,7 @@
 #include "klee/ADT/Bits.h"
 #include "klee/Expr/Expr.h"
 #include "klee/Solver/Solver.h"
+#include "klee/Solver/SolverCmdLine.h"
 #include "klee/Solver/SolverStats.h"
 
 #include "ConstantDivision.h"
@@ -53,30 +54,13 @@ namespace {
 ///
 
 
-STPArrayExprHash::~STPArrayExprHash() {
-  for (ArrayHashIter it = _array_hash.begin(); it != _array_hash.end(); ++it) {
-    ::VCExpr array_expr = it->second;
-    if (array_expr) {
-      ::vc_DeleteExpr(array_expr);
-      array_expr = 0;
-    }
-  }
-
-
-  for (UpdateNodeHashConstIter it = _update_node_hash.begin();
-      it != _update_node_hash.end(); ++it) {
-    ::VCExpr un_expr = it->second;
-    if (un_expr) {
-      ::vc_DeleteExpr(un_expr);
-      un_expr = 0;
-    }
-  }
-}
+STPArrayExprHash::~STPArrayExprHash() {}
 
 /***/
 
 STPBuilder::STPBuilder(::VC _vc, bool _optimizeDivides)
-  : vc(_vc), optimizeDivides(_optimizeDivides) {
+  : vc(_vc), constructed(ConstructCacheSize), updates(ConstructCacheSize),
+    query(0), optimizeDivides(_optimizeDivides) {
 
 }
 
@@ -427,10 +411,10 @@ ExprHandle STPBuilder::constructSDivByConstant(ExprHandle expr_n, unsigned width
   return res;
 }
 
-::VCExpr STPBuilder::getInitialArray(const Array *root) {
+ExprHandle STPBuilder::getInitialArray(const Array *root) {
   
   assert(root);
-  ::VCExpr array_expr;
+  ExprHandle array_expr;
   bool hashed = _arr_hash.lookupArrayExpr(root, array_expr);
   
   if (!hashed) {
@@ -447,11 +431,9 @@ ExprHandle STPBuilder::constructSDivByConstant(ExprHandle expr_n, unsigned width
       // using assertions, which is much faster, but we need to fix the caching
       // to work correctly in that case.
       for (unsigned i = 0, e = root->size; i != e; ++i) {
-	::VCExpr prev = array_expr;
-	array_expr = vc_writeExpr(vc, prev,
+	array_expr = vc_writeExpr(vc, array_expr,
                        construct(ConstantExpr::alloc(i, root->getDomain()), 0),
                        construct(root->constantValues[i], 0));
-	vc_DeleteExpr(prev);
       }
     }
     
@@ -465,24 +447,24 @@ ExprHandle STPBuilder::getInitialRead(const Array *root, unsigned index) {
   return vc_readExpr(vc, getInitialArray(root), bvConst32(32, index));
 }
 
-::VCExpr STPBuilder::getArrayForUpdate(const Array *root, 
-                                       const UpdateNode *un) {
-  if (!un) {
+ExprHandle STPBuilder::getArrayForUpdate(const Array *root,
+                                         const ref<UpdateNode> &un) {
+  if (un.isNull()) {
       return getInitialArray(root);
   }
   else {
       // FIXME: This really needs to be non-recursive.
-      ::VCExpr un_expr;
-      bool hashed = _arr_hash.lookupUpdateNodeExpr(un, un_expr);
-      
-      if (!hashed) {
-        un_expr =
-            vc_writeExpr(vc, getArrayForUpdate(root, un->next.get()),
-                         construct(un->index, 0), construct(un->value, 0));
-
-        _arr_hash.hashUpdateNodeExpr(un, un_expr);
+      if (CachedEncoding *cached = updates.find(un)) {
+        if (cached->query != query)
+          ++stats::queryConstructCacheHits;
+        return cached->ast;
       }
-      
+      ++stats::queryConstructCacheMisses;
+
+      ExprHandle un_expr =
+          vc_writeExpr(vc, getArrayForUpdate(root, un->next),
+                       construct(un->index, 0), construct(un->value, 0));
+      updates.insert(un, {un_expr, 0, query});
       return un_expr;
   }
 }
@@ -493,17 +475,18 @@ ExprHandle STPBuilder::construct(ref<Expr> e, int *width_out) {
   if (!UseConstructHash || isa<ConstantExpr>(e)) {
     return constructActual(e, width_out);
   } else {
-    ExprHashMap< std::pair<ExprHandle, unsigned> >::iterator it = 
-      constructed.find(e);
-    if (it!=constructed.end()) {
+    if (CachedEncoding *cached = constructed.find(e)) {
+      if (cached->query != query)
+        ++stats::queryConstructCacheHits;
       if (width_out)
-        *width_out = it->second.second;
-      return it->second.first;
+        *width_out = cached->width;
+      return cached->ast;
     } else {
+      ++stats::queryConstructCacheMisses;
       int width;
       if (!width_out) width_out = &width;
       ExprHandle res = constructActual(e, width_out);
-      constructed.insert(std::make_pair(e, std::make_pair(res, *width_out)));
+      constructed.insert(e, {res, unsigned(*width_out), query});
       return res;
     }
   }
@@ -556,7 +539,7 @@ ExprHandle STPBuilder::constructActual(ref<Expr> e, int *width_out) {
     assert(re && re->updates.root);
     *width_out = re->updates.root->getRange();
     return vc_readExpr(
-        vc, getArrayForUpdate(re->updates.root, re->updates.head.get()),
+        vc, getArrayForUpdate(re->updates.root, re->updates.head),
         construct(re->index, 0));
   }
     
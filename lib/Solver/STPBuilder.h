@@ -10,6 +10,7 @@
 #ifndef KLEE_STPBUILDER_H
 #define KLEE_STPBUILDER_H
 
+#include "klee/ADT/LRUCache.h"
 #include "klee/Config/config.h"
 #include "klee/Expr/ArrayExprHash.h"
 #include "klee/Expr/ExprHashMap.h"
@@ -53,7 +54,7 @@ namespace klee {
     operator ::VCExpr () { return H->expr; }
   };
   
-  class STPArrayExprHash : public ArrayExprHash< ::VCExpr > {
+  class STPArrayExprHash : public ArrayExprHash<ExprHandle> {
     
     friend class STPBuilder;
     
@@ -64,7 +65,24 @@ namespace klee {
 
 class STPBuilder {
   ::VC vc;
-  ExprHashMap< std::pair<ExprHandle, unsigned> > constructed;
+  /// An encoding with its width (for expressions) and the number of the
+  /// query it was constructed for
+  struct CachedEncoding {
+    ExprHandle ast;
+    unsigned width;
+    unsigned query;
+  };
+
+  /// Encodings of expressions and array updates, kept across queries as
+  /// long as they are among the most recently used
+  LRUCache<ref<Expr>, CachedEncoding, util::ExprHash, util::ExprCmp>
+      constructed;
+  LRUCache<ref<UpdateNode>, CachedEncoding, UpdateNodeRefHashFn,
+           UpdateNodeRefCmpFn>
+      updates;
+
+  /// Number of the current query, see startQuery
+  unsigned query;
 
   /// optimizeDivides - Rewrite division and reminders by constants
   /// into multiplies and shifts. STP should probably handle this for
@@ -102,8 +120,8 @@ private:
   ExprHandle constructUDivByConstant(ExprHandle expr_n, unsigned width, uint64_t d);
   ExprHandle constructSDivByConstant(ExprHandle expr_n, unsigned width, uint64_t d);
 
-  ::VCExpr getInitialArray(const Array *os);
-  ::VCExpr getArrayForUpdate(const Array *root, const UpdateNode *un);
+  ExprHandle getInitialArray(const Array *os);
+  ExprHandle getArrayForUpdate(const Array *root, const ref<UpdateNode> &un);
 
   ExprHandle constructActual(ref<Expr> e, int *width_out);
   ExprHandle construct(ref<Expr> e, int *width_out);
@@ -119,11 +137,11 @@ public:
   ExprHandle getFalse();
   ExprHandle getInitialRead(const Array *os, unsigned index);
 
-  ExprHandle construct(ref<Expr> e) { 
-    ExprHandle res = construct(e, 0);
-    constructed.clear();
-    return res;
-  }
+  /// Starts a new query. Only encodings reused from earlier queries count
+  /// as construct cache hits.
+  void startQuery() { ++query; }
+
+  ExprHandle construct(ref<Expr> e) { return construct(e, 0); }
 };
 
 }
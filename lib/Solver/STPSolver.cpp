@@ -134,6 +134,7 @@ STPSolverImpl::~STPSolverImpl() {
 /***/
 
 char *STPSolverImpl::getConstraintLog(const Query &query) {
+  builder->startQuery();
   vc_push(vc);
 
   for (const auto &constraint : query.constraints)
@@ -320,6 +321,7 @@ bool STPSolverImpl::computeInitialValues(
     std::vector<std::vector<unsigned char>> &values, bool &hasSolution) {
   runStatusCode = SOLVER_RUN_STATUS_FAILURE;
   TimerStatIncrementer t(stats::queryTime);
+  builder->startQuery();
 
   vc_push(vc);
 
@@ -70,6 +70,33 @@ bool Solver::mayBeTrue(const Query& query, bool &result) {
   return true;
 }
 
+bool Solver::mayBeTrue(const ConstraintSet &constraints,
+                       const std::vector<ref<Expr> > &exprs,
+                       std::vector<bool> &results) {
+  results.assign(exprs.size(), false);
+
+  // Maintain invariants implementations expect.
+  std::vector<ref<Expr> > symbolic;
+  std::vector<std::size_t> indices;
+  for (std::size_t i = 0; i < exprs.size(); ++i) {
+    if (ConstantExpr *CE = dyn_cast<ConstantExpr>(exprs[i])) {
+      results[i] = CE->isTrue();
+    } else {
+      symbolic.push_back(exprs[i]);
+      indices.push_back(i);
+    }
+  }
+  if (symbolic.empty())
+    return true;
+
+  std::vector<bool> symbolicResults;
+  if (!impl->computeMayBeTrue(constraints, symbolic, symbolicResults))
+    return false;
+  for (std::size_t i = 0; i < indices.size(); ++i)
+    results[indices[i]] = symbolicResults[i];
+  return true;
+}
+
 bool Solver::mayBeFalse(const Query& query, bool &result) {
   bool res;
   if (!mustBeTrue(query, res))
@@ -43,6 +43,12 @@ cl::opt<bool> UseFastCexSolver(
     cl::desc("Enable an experimental range-based solver (default=false)"),
     cl::cat(SolvingCat));
 
+cl::opt<bool> UseBitRangeSolver(
+    "use-bit-range-solver", cl::init(false),
+    cl::desc("Decide queries using the known bits and value ranges of the "
+             "symbolic inputs before calling the core solver (default=false)"),
+    cl::cat(SolvingCat));
+
 cl::opt<bool> UseCexCache("use-cex-cache", cl::init(true),
                           cl::desc("Use the counterexample cache (default=true)"),
                           cl::cat(SolvingCat));
@@ -51,6 +57,20 @@ cl::opt<bool> UseBranchCache("use-branch-cache", cl::init(true),
                              cl::desc("Use the branch cache (default=true)"),
                              cl::cat(SolvingCat));
 
+cl::opt<std::string> PersistentQueryCache(
+    "persistent-query-cache",
+    cl::desc("Cache solver results in the given file, which is shared with "
+             "other runs of KLEE and may be used by several KLEE processes "
+             "at once (default=off)"),
+    cl::value_desc("path"), cl::cat(SolvingCat));
+
+cl::opt<unsigned> PersistentQueryCacheMaxSize(
+    "persistent-query-cache-max-size",
+    cl::desc("Stop adding results to the persistent query cache once its file "
+             "reaches this size in MiB, records are never removed from it. "
+             "Set to 0 for no limit (default=1024)"),
+    cl::init(1024), cl::cat(SolvingCat));
+
 cl::opt<bool>
     UseIndependentSolver("use-independent-solver", cl::init(true),
                          cl::desc("Use constraint independence (default=true)"),
@@ -90,6 +110,13 @@ cl::opt<bool> CoreSolverOptimizeDivides(
              "passing them to the core SMT solver (default=false)"),
     cl::init(false), cl::cat(SolvingCat));
 
+cl::opt<unsigned> ConstructCacheSize(
+    "construct-cache-size",
+    cl::desc("Maximum number of expressions and array updates whose encoding "
+             "the STP and Z3 core solvers keep for later queries "
+             "(default=65536)"),
+    cl::init(65536), cl::cat(SolvingCat));
+
 cl::bits<QueryLoggingSolverType> QueryLoggingOptions(
     "use-query-log",
     cl::desc("Log queries to a file. Multiple options can be specified "
@@ -195,10 +222,24 @@ cl::opt<CoreSolverType> CoreSolverToUse(
                clEnumValN(METASMT_SOLVER, "metasmt",
                           "metaSMT" METASMT_IS_DEFAULT_STR),
                clEnumValN(DUMMY_SOLVER, "dummy", "Dummy solver"),
-               clEnumValN(Z3_SOLVER, "z3", "Z3" Z3_IS_DEFAULT_STR)
+               clEnumValN(Z3_SOLVER, "z3", "Z3" Z3_IS_DEFAULT_STR),
+               clEnumValN(PORTFOLIO_SOLVER, "portfolio",
+                          "Run the backends given by --solver-portfolio "
+                          "concurrently and take the first answer")
                    KLEE_LLVM_CL_VAL_END),
     cl::init(DEFAULT_CORE_SOLVER), cl::cat(SolvingCat));
 
+cl::list<CoreSolverType> PortfolioSolvers(
+    "solver-portfolio",
+    cl::desc("Comma-separated list of the core solver backends raced by "
+             "--solver-backend=portfolio (default=all available backends)"),
+    cl::values(clEnumValN(STP_SOLVER, "stp", "STP"),
+               clEnumValN(METASMT_SOLVER, "metasmt", "metaSMT"),
+               clEnumValN(DUMMY_SOLVER, "dummy", "Dummy solver"),
+               clEnumValN(Z3_SOLVER, "z3", "Z3")
+                   KLEE_LLVM_CL_VAL_END),
+    cl::CommaSeparated, cl::cat(SolvingCat));
+
 cl::opt<CoreSolverType> DebugCrossCheckCoreSolverWith(
     "debug-crosscheck-core-solver",
     cl::desc(
@@ -7,6 +7,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "klee/Expr/Assignment.h"
+#include "klee/Expr/ExprUtil.h"
 #include "klee/Solver/Solver.h"
 #include "klee/Solver/SolverImpl.h"
 
@@ -28,6 +30,65 @@ bool SolverImpl::computeValidity(const Query &query, Solver::Validity &result) {
   return true;
 }
 
+bool SolverImpl::computeMayBeTrue(const ConstraintSet &constraints,
+                                  const std::vector<ref<Expr> > &exprs,
+                                  std::vector<bool> &results) {
+  results.assign(exprs.size(), false);
+  std::vector<std::size_t> pending;
+  for (std::size_t i = 0; i < exprs.size(); ++i)
+    pending.push_back(i);
+
+  while (!pending.empty()) {
+    // Ask for an assignment in which any of the pending expressions holds,
+    // all expressions true in it are feasible.
+    ref<Expr> none = ConstantExpr::alloc(1, Expr::Bool);
+    std::vector<ref<Expr> > pendingExprs;
+    for (auto i : pending) {
+      none = AndExpr::create(none, Expr::createIsZero(exprs[i]));
+      pendingExprs.push_back(exprs[i]);
+    }
+
+    std::vector<std::size_t> remaining;
+    if (!isa<ConstantExpr>(none)) {
+      std::vector<const Array *> objects;
+      findSymbolicObjects(pendingExprs.begin(), pendingExprs.end(), objects);
+      std::vector<std::vector<unsigned char> > values;
+      bool hasSolution;
+      if (!computeInitialValues(Query(constraints, none), objects, values,
+                                hasSolution))
+        return false;
+      if (!hasSolution)
+        return true;
+
+      Assignment assignment(objects, values);
+      for (auto i : pending) {
+        ref<Expr> value = assignment.evaluate(exprs[i]);
+        if (isa<ConstantExpr>(value) && cast<ConstantExpr>(value)->isTrue())
+          results[i] = true;
+        else
+          remaining.push_back(i);
+      }
+      if (remaining.size() < pending.size()) {
+        pending.swap(remaining);
+        continue;
+      }
+    }
+
+    // The disjunction simplified to a constant or the assignment did not
+    // decide any expression, check the rest one by one.
+    for (auto i : pending) {
+      bool isValid;
+      if (!computeTruth(Query(constraints, Expr::createIsZero(exprs[i])),
+                        isValid))
+        return false;
+      results[i] = !isValid;
+    }
+    break;
+  }
+
+  return true;
+}
+
 const char *SolverImpl::getOperationStatusString(SolverRunStatus statusCode) {
   switch (statusCode) {
   case SOLVER_RUN_STATUS_SUCCESS_SOLVABLE:
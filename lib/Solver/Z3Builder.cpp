@@ -13,6 +13,7 @@
 #include "klee/ADT/Bits.h"
 #include "klee/Expr/Expr.h"
 #include "klee/Solver/Solver.h"
+#include "klee/Solver/SolverCmdLine.h"
 #include "klee/Solver/SolverStats.h"
 #include "klee/Support/ErrorHandling.h"
 
@@ -75,7 +76,8 @@ void Z3ArrayExprHash::clear() {
 }
 
 Z3Builder::Z3Builder(bool autoClearConstructCache, const char* z3LogInteractionFileArg)
-    : autoClearConstructCache(autoClearConstructCache), z3LogInteractionFile("") {
+    : constructed(ConstructCacheSize), updates(ConstructCacheSize), query(0),
+      autoClearConstructCache(autoClearConstructCache), z3LogInteractionFile("") {
   if (z3LogInteractionFileArg)
     this->z3LogInteractionFile = std::string(z3LogInteractionFileArg);
   if (z3LogInteractionFile.length() > 0) {
@@ -426,21 +428,22 @@ Z3ASTHandle Z3Builder::getInitialRead(const Array *root, unsigned index) {
 }
 
 Z3ASTHandle Z3Builder::getArrayForUpdate(const Array *root,
-                                         const UpdateNode *un) {
-  if (!un) {
+                                         const ref<UpdateNode> &un) {
+  if (un.isNull()) {
     return (getInitialArray(root));
   } else {
     // FIXME: This really needs to be non-recursive.
-    Z3ASTHandle un_expr;
-    bool hashed = _arr_hash.lookupUpdateNodeExpr(un, un_expr);
-
-    if (!hashed) {
-      un_expr = writeExpr(getArrayForUpdate(root, un->next.get()),
-                          construct(un->index, 0), construct(un->value, 0));
-
-      _arr_hash.hashUpdateNodeExpr(un, un_expr);
+    if (CachedEncoding *cached = updates.find(un)) {
+      if (cached->query != query)
+        ++stats::queryConstructCacheHits;
+      return cached->ast;
     }
+    ++stats::queryConstructCacheMisses;
 
+    Z3ASTHandle un_expr =
+        writeExpr(getArrayForUpdate(root, un->next), construct(un->index, 0),
+                  construct(un->value, 0));
+    updates.insert(un, {un_expr, 0, query});
     return (un_expr);
   }
 }
@@ -453,18 +456,19 @@ Z3ASTHandle Z3Builder::construct(ref<Expr> e, int *width_out) {
   if (!UseConstructHashZ3 || isa<ConstantExpr>(e)) {
     return constructActual(e, width_out);
   } else {
-    ExprHashMap<std::pair<Z3ASTHandle, unsigned> >::iterator it =
-        constructed.find(e);
-    if (it != constructed.end()) {
+    if (CachedEncoding *cached = constructed.find(e)) {
+      if (cached->query != query)
+        ++stats::queryConstructCacheHits;
       if (width_out)
-        *width_out = it->second.second;
-      return it->second.first;
+        *width_out = cached->width;
+      return cached->ast;
     } else {
+      ++stats::queryConstructCacheMisses;
       int width;
       if (!width_out)
         width_out = &width;
       Z3ASTHandle res = constructActual(e, width_out);
-      constructed.insert(std::make_pair(e, std::make_pair(res, *width_out)));
+      constructed.insert(e, {res, unsigned(*width_out), query});
       return res;
     }
   }
@@ -518,7 +522,7 @@ Z3ASTHandle Z3Builder::constructActual(ref<Expr> e, int *width_out) {
     ReadExpr *re = cast<ReadExpr>(e);
     assert(re && re->updates.root);
     *width_out = re->updates.root->getRange();
-    return readExpr(getArrayForUpdate(re->updates.root, re->updates.head.get()),
+    return readExpr(getArrayForUpdate(re->updates.root, re->updates.head),
                     construct(re->index, 0));
   }
 
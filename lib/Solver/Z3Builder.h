@@ -10,6 +10,7 @@
 #ifndef KLEE_Z3BUILDER_H
 #define KLEE_Z3BUILDER_H
 
+#include "klee/ADT/LRUCache.h"
 #include "klee/Config/config.h"
 #include "klee/Expr/ArrayExprHash.h"
 #include "klee/Expr/ExprHashMap.h"
@@ -102,7 +103,24 @@ public:
 };
 
 class Z3Builder {
-  ExprHashMap<std::pair<Z3ASTHandle, unsigned> > constructed;
+  /// An encoding with its width (for expressions) and the number of the
+  /// query it was constructed for
+  struct CachedEncoding {
+    Z3ASTHandle ast;
+    unsigned width;
+    unsigned query;
+  };
+
+  /// Encodings of expressions and array updates, kept across queries as
+  /// long as they are among the most recently used
+  LRUCache<ref<Expr>, CachedEncoding, util::ExprHash, util::ExprCmp>
+      constructed;
+  LRUCache<ref<UpdateNode>, CachedEncoding, UpdateNodeRefHashFn,
+           UpdateNodeRefCmpFn>
+      updates;
+
+  /// Number of the current query, see startQuery
+  unsigned query;
   Z3ArrayExprHash _arr_hash;
 
 private:
@@ -156,7 +174,8 @@ private:
                                       Z3ASTHandle isSigned);
 
   Z3ASTHandle getInitialArray(const Array *os);
-  Z3ASTHandle getArrayForUpdate(const Array *root, const UpdateNode *un);
+  Z3ASTHandle getArrayForUpdate(const Array *root,
+                                const ref<UpdateNode> &un);
 
   Z3ASTHandle constructActual(ref<Expr> e, int *width_out);
   Z3ASTHandle construct(ref<Expr> e, int *width_out);
@@ -180,6 +199,10 @@ public:
   Z3ASTHandle getFalse();
   Z3ASTHandle getInitialRead(const Array *os, unsigned index);
 
+  /// Starts a new query. Only encodings reused from earlier queries count
+  /// as construct cache hits.
+  void startQuery() { ++query; }
+
   Z3ASTHandle construct(ref<Expr> e) {
     Z3ASTHandle res = construct(e, 0);
     if (autoClearConstructCache)
@@ -187,7 +210,10 @@ public:
     return res;
   }
 
-  void clearConstructCache() { constructed.clear(); }
+  void clearConstructCache() {
+    constructed.clear();
+    updates.clear();
+  }
 };
 }
 
@@ -51,6 +51,15 @@ llvm::cl::opt<unsigned>
                      llvm::cl::cat(klee::SolvingCat));
 }
 
+namespace klee {
+llvm::cl::opt<bool> Z3Incremental(
+    "z3-incremental", llvm::cl::init(false),
+    llvm::cl::desc("Keep a persistent Z3 solver and only assert the "
+                   "constraints that differ from the previous query, using "
+                   "push/pop (default=false)"),
+    llvm::cl::cat(klee::SolvingCat));
+}
+
 #include "llvm/Support/ErrorHandling.h"
 
 namespace klee {
@@ -65,6 +74,15 @@ private:
   // Parameter symbols
   ::Z3_symbol timeoutParamStrSymbol;
 
+  // Persistent solver used by --z3-incremental. Each constraint in
+  // `assertedConstraints` lives in its own backtracking scope, so the solver
+  // can be popped back to the longest prefix shared with the next query.
+  ::Z3_solver incrementalSolver;
+  std::vector<ref<Expr> > assertedConstraints;
+
+  ::Z3_solver getIncrementalSolver(const ConstraintSet &constraints);
+  void resetIncrementalSolver();
+
   bool internalRunSolver(const Query &,
                          const std::vector<const Array *> *objects,
                          std::vector<std::vector<unsigned char> > *values,
@@ -87,6 +105,9 @@ public:
   }
 
   bool computeTruth(const Query &, bool &isValid);
+  bool computeMayBeTrue(const ConstraintSet &constraints,
+                        const std::vector<ref<Expr> > &exprs,
+                        std::vector<bool> &results);
   bool computeValue(const Query &, ref<Expr> &result);
   bool computeInitialValues(const Query &,
                             const std::vector<const Array *> &objects,
@@ -106,7 +127,7 @@ Z3SolverImpl::Z3SolverImpl()
           /*z3LogInteractionFileArg=*/Z3LogInteractionFile.size() > 0
               ? Z3LogInteractionFile.c_str()
               : NULL)),
-      runStatusCode(SOLVER_RUN_STATUS_FAILURE) {
+      runStatusCode(SOLVER_RUN_STATUS_FAILURE), incrementalSolver(nullptr) {
   assert(builder && "unable to create Z3Builder");
   solverParameters = Z3_mk_params(builder->ctx);
   Z3_params_inc_ref(builder->ctx, solverParameters);
@@ -134,6 +155,7 @@ Z3SolverImpl::Z3SolverImpl()
 }
 
 Z3SolverImpl::~Z3SolverImpl() {
+  resetIncrementalSolver();
   Z3_params_dec_ref(builder->ctx, solverParameters);
   delete builder;
 }
@@ -221,6 +243,123 @@ bool Z3SolverImpl::computeTruth(const Query &query, bool &isValid) {
   return status;
 }
 
+bool Z3SolverImpl::computeMayBeTrue(const ConstraintSet &constraints,
+                                    const std::vector<ref<Expr> > &exprs,
+                                    std::vector<bool> &results) {
+  TimerStatIncrementer t(stats::queryTime);
+  builder->startQuery();
+  // Assert the shared constraints only once. Each check then asks for a model
+  // of any expression not known to be feasible yet, and every expression true
+  // in that model is feasible. The disjunctions only get stronger, so they
+  // are simply added on top of each other instead of using push/pop.
+  Z3_solver theSolver;
+  if (Z3Incremental) {
+    theSolver = getIncrementalSolver(constraints);
+    Z3_solver_inc_ref(builder->ctx, theSolver);
+  } else {
+    resetIncrementalSolver();
+    theSolver = Z3_mk_solver(builder->ctx);
+    Z3_solver_inc_ref(builder->ctx, theSolver);
+    for (auto const &constraint : constraints)
+      Z3_solver_assert(builder->ctx, theSolver, builder->construct(constraint));
+  }
+  Z3_solver_set_params(builder->ctx, theSolver, solverParameters);
+
+  ConstantArrayFinder constant_arrays_in_query;
+  for (auto const &constraint : constraints)
+    constant_arrays_in_query.visit(constraint);
+  std::vector<Z3ASTHandle> z3Exprs;
+  for (auto const &expr : exprs) {
+    z3Exprs.push_back(builder->construct(expr));
+    constant_arrays_in_query.visit(expr);
+  }
+  for (auto const &constant_array : constant_arrays_in_query.results) {
+    assert(builder->constant_array_assertions.count(constant_array) == 1 &&
+           "Constant array found in query, but not handled by Z3Builder");
+    for (auto const &arrayIndexValueExpr :
+         builder->constant_array_assertions[constant_array]) {
+      Z3_solver_assert(builder->ctx, theSolver, arrayIndexValueExpr);
+    }
+  }
+
+  results.assign(exprs.size(), false);
+  std::vector<std::size_t> pending(exprs.size());
+  for (std::size_t i = 0; i < pending.size(); ++i)
+    pending[i] = i;
+
+  runStatusCode = SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE;
+  while (!pending.empty()) {
+    std::vector<::Z3_ast> disjuncts;
+    for (auto i : pending)
+      disjuncts.push_back(z3Exprs[i]);
+    Z3_solver_assert(
+        builder->ctx, theSolver,
+        Z3ASTHandle(Z3_mk_or(builder->ctx, disjuncts.size(), disjuncts.data()),
+                    builder->ctx));
+    ++stats::queries;
+
+    if (dumpedQueriesFile) {
+      *dumpedQueriesFile << "; start Z3 query\n";
+      *dumpedQueriesFile << Z3_solver_to_string(builder->ctx, theSolver);
+      *dumpedQueriesFile << "(check-sat)\n";
+      *dumpedQueriesFile << "(reset)\n";
+      *dumpedQueriesFile << "; end Z3 query\n\n";
+      dumpedQueriesFile->flush();
+    }
+
+    ::Z3_lbool satisfiable = Z3_solver_check(builder->ctx, theSolver);
+    bool hasSolution;
+    runStatusCode = handleSolverResponse(theSolver, satisfiable, nullptr,
+                                         nullptr, hasSolution);
+    if (runStatusCode != SolverImpl::SOLVER_RUN_STATUS_SUCCESS_SOLVABLE) {
+      if (runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE)
+        ++stats::queriesValid;
+      break;
+    }
+    ++stats::queriesInvalid;
+
+    ::Z3_model theModel = Z3_solver_get_model(builder->ctx, theSolver);
+    assert(theModel && "Failed to retrieve model");
+    Z3_model_inc_ref(builder->ctx, theModel);
+    std::vector<std::size_t> remaining;
+    for (auto i : pending) {
+      ::Z3_ast rawEvaluatedExpr;
+      __attribute__((unused))
+      bool successfulEval =
+          Z3_model_eval(builder->ctx, theModel, z3Exprs[i],
+                        /*model_completion=*/Z3_TRUE, &rawEvaluatedExpr);
+      assert(successfulEval && "Failed to evaluate model");
+      Z3ASTHandle evaluatedExpr(rawEvaluatedExpr, builder->ctx);
+      if (Z3_get_bool_value(builder->ctx, evaluatedExpr) == Z3_L_TRUE)
+        results[i] = true;
+      else
+        remaining.push_back(i);
+    }
+    Z3_model_dec_ref(builder->ctx, theModel);
+
+    assert(remaining.size() < pending.size() &&
+           "model does not satisfy any of the expressions");
+    pending.swap(remaining);
+  }
+
+  if (theSolver == incrementalSolver) {
+    if (runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_SOLVABLE ||
+        runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE)
+      Z3_solver_pop(builder->ctx, theSolver, 1);
+    else
+      resetIncrementalSolver();
+  }
+  Z3_solver_dec_ref(builder->ctx, theSolver);
+
+  if (runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_SOLVABLE ||
+      runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE)
+    return true;
+  if (runStatusCode == SolverImpl::SOLVER_RUN_STATUS_INTERRUPTED) {
+    raise(SIGINT);
+  }
+  return false;
+}
+
 bool Z3SolverImpl::computeValue(const Query &query, ref<Expr> &result) {
   std::vector<const Array *> objects;
   std::vector<std::vector<unsigned char> > values;
@@ -246,28 +385,78 @@ bool Z3SolverImpl::computeInitialValues(
   return internalRunSolver(query, &objects, &values, hasSolution);
 }
 
+void Z3SolverImpl::resetIncrementalSolver() {
+  if (!incrementalSolver)
+    return;
+  Z3_solver_dec_ref(builder->ctx, incrementalSolver);
+  incrementalSolver = nullptr;
+  assertedConstraints.clear();
+}
+
+::Z3_solver
+Z3SolverImpl::getIncrementalSolver(const ConstraintSet &constraints) {
+  // Successive queries on one path, and queries of sibling paths, share
+  // long constraint prefixes. Only backtrack to where they diverge.
+  std::size_t common = 0;
+  auto it = constraints.begin(), ie = constraints.end();
+  for (; common < assertedConstraints.size() && it != ie; ++common, ++it) {
+    if (assertedConstraints[common] != *it)
+      break;
+  }
+
+  if (common == 0) {
+    // Nothing to reuse: a fresh solver avoids carrying learned state from
+    // an unrelated path.
+    resetIncrementalSolver();
+    incrementalSolver = Z3_mk_solver(builder->ctx);
+    Z3_solver_inc_ref(builder->ctx, incrementalSolver);
+  } else if (common < assertedConstraints.size()) {
+    Z3_solver_pop(builder->ctx, incrementalSolver,
+                  assertedConstraints.size() - common);
+    assertedConstraints.resize(common);
+  }
+
+  for (; it != ie; ++it) {
+    Z3_solver_push(builder->ctx, incrementalSolver);
+    Z3_solver_assert(builder->ctx, incrementalSolver, builder->construct(*it));
+    assertedConstraints.push_back(*it);
+  }
+
+  // Scope for the query itself, popped once it has been answered
+  Z3_solver_push(builder->ctx, incrementalSolver);
+  return incrementalSolver;
+}
+
 bool Z3SolverImpl::internalRunSolver(
     const Query &query, const std::vector<const Array *> *objects,
     std::vector<std::vector<unsigned char> > *values, bool &hasSolution) {
 
   TimerStatIncrementer t(stats::queryTime);
+  builder->startQuery();
   // NOTE: Z3 will switch to using a slower solver internally if push/pop are
-  // used so for now it is likely that creating a new solver each time is the
-  // right way to go until Z3 changes its behaviour.
+  // used so by default a new solver is created for each query. Whether
+  // --z3-incremental pays off depends on how much the queries share.
   //
   // TODO: Investigate using a custom tactic as described in
   // https://github.com/klee/klee/issues/653
-  Z3_solver theSolver = Z3_mk_solver(builder->ctx);
-  Z3_solver_inc_ref(builder->ctx, theSolver);
+  Z3_solver theSolver;
+  if (Z3Incremental) {
+    theSolver = getIncrementalSolver(query.constraints);
+    Z3_solver_inc_ref(builder->ctx, theSolver);
+  } else {
+    resetIncrementalSolver();
+    theSolver = Z3_mk_solver(builder->ctx);
+    Z3_solver_inc_ref(builder->ctx, theSolver);
+    for (auto const &constraint : query.constraints)
+      Z3_solver_assert(builder->ctx, theSolver, builder->construct(constraint));
+  }
   Z3_solver_set_params(builder->ctx, theSolver, solverParameters);
 
   runStatusCode = SOLVER_RUN_STATUS_FAILURE;
 
   ConstantArrayFinder constant_arrays_in_query;
-  for (auto const &constraint : query.constraints) {
-    Z3_solver_assert(builder->ctx, theSolver, builder->construct(constraint));
+  for (auto const &constraint : query.constraints)
     constant_arrays_in_query.visit(constraint);
-  }
   ++stats::queries;
   if (objects)
     ++stats::queryCounterexamples;
@@ -307,13 +496,18 @@ bool Z3SolverImpl::internalRunSolver(
   runStatusCode = handleSolverResponse(theSolver, satisfiable, objects, values,
                                        hasSolution);
 
+  if (theSolver == incrementalSolver) {
+    if (runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_SOLVABLE ||
+        runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE)
+      Z3_solver_pop(builder->ctx, theSolver, 1);
+    else
+      resetIncrementalSolver();
+  }
   Z3_solver_dec_ref(builder->ctx, theSolver);
-  // Clear the builder's cache to prevent memory usage exploding.
-  // By using ``autoClearConstructCache=false`` and clearning now
-  // we allow Z3_ast expressions to be shared from an entire
-  // ``Query`` rather than only sharing within a single call to
+  // The builder's cache is not cleared here. It is bounded, so by using
+  // ``autoClearConstructCache=false`` Z3_ast expressions are shared between
+  // queries rather than only within a single call to
   // ``builder->construct()``.
-  builder->clearConstructCache();
 
   if (runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_SOLVABLE ||
       runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE) {
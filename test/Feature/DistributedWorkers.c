@@ -0,0 +1,25 @@
+// RUN: %clang %s -emit-llvm %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --distributed-workers=2 --distributed-prefix-depth=5 %t.bc 2>&1 | FileCheck %s
+// RUN: ls %t.klee-out | grep -c "\.ktest$" | FileCheck --check-prefix=CHECK-TESTS %s
+// RUN: ls %t.klee-out | grep -c "^job-" | FileCheck --check-prefix=CHECK-JOBS %s
+
+#include "klee/klee.h"
+
+int main() {
+  int x;
+  klee_make_symbolic(&x, sizeof x, "x");
+
+  // 16 paths, fewer symbolic branches than the prefix has decisions
+  if (x & 1) klee_warning("bit 0");
+  if (x & 2) klee_warning("bit 1");
+  if (x & 4) klee_warning("bit 2");
+  if (x & 8) klee_warning("bit 3");
+
+  return 0;
+}
+
+// CHECK: KLEE: done: distributed jobs = 32 of 32 (0 failed)
+// CHECK: KLEE: done: generated tests = 16
+// CHECK-TESTS: 16
+// CHECK-JOBS: 32
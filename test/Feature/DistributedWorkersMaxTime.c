@@ -0,0 +1,21 @@
+// RUN: %clang %s -emit-llvm %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// Eight jobs on two workers would take 4 x 4s if every job got the whole --max-time
+// RUN: timeout 12 %klee --output-dir=%t.klee-out --max-time=4s --distributed-workers=2 --distributed-prefix-depth=3 %t.bc 2>&1 | FileCheck %s
+
+#include "klee/klee.h"
+
+int main() {
+  unsigned x, bits = 0;
+  klee_make_symbolic(&x, sizeof x, "x");
+
+  // every path prefix is feasible, and no job ever runs out of work
+  for (unsigned mask = 1;; mask = mask << 1 ? mask << 1 : 1) {
+    if (x & mask)
+      ++bits;
+  }
+
+  return 0;
+}
+
+// CHECK: KLEE: done: distributed jobs = {{[0-9]+}} of 8
@@ -0,0 +1,47 @@
+// RUN: %clang %s -emit-llvm %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --native-calls --exit-on-error %t.bc 2>&1 | FileCheck %s
+
+#include "klee/klee.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+unsigned table[256];
+
+// Executed natively, as memory and arguments are concrete
+unsigned init(unsigned poly) {
+  for (unsigned n = 0; n < 256; n++) {
+    unsigned c = n;
+    for (int k = 0; k < 8; k++)
+      c = c & 1 ? poly ^ (c >> 1) : c >> 1;
+    table[n] = c;
+  }
+  return table[1];
+}
+
+// Escapes to the interpreter on the call to printf
+void report(unsigned n) {
+  for (unsigned i = 0; i < n; i++)
+    printf("entry %u\n", table[i]);
+}
+
+int main() {
+  // CHECK-NOT: could not be executed natively
+  assert(init(0xEDB88320) == 0x77073096);
+  assert(table[255] == 0x2D02EF8D);
+
+  // CHECK: interpreting call to report, which could not be executed natively
+  // CHECK: entry 0
+  // CHECK: entry 1996959894
+  report(2);
+
+  unsigned x;
+  klee_make_symbolic(&x, sizeof x, "x");
+  // Interpreted, as memory is not concrete anymore
+  assert(init(0x82F63B78) == 0xF26B8303);
+  if (x == table[1])
+    return 1;
+
+  return 0;
+}
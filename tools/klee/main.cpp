@@ -59,6 +59,8 @@
 #include <fstream>
 #include <iomanip>
 #include <iterator>
+#include <map>
+#include <memory>
 #include <sstream>
 
 
@@ -158,6 +160,24 @@ namespace {
   WarnAllExternals("warn-all-external-symbols",
                    cl::desc("Issue a warning on startup for all external symbols (default=false)."),
                    cl::cat(StartCat));
+
+  cl::opt<unsigned>
+  DistributedWorkers("distributed-workers",
+                     cl::desc("Split the exploration into path-prefix jobs that are run by the given number "
+                              "of concurrent worker processes, and merge their test cases into the output "
+                              "directory. --max-time, --max-instructions and --max-tests apply to the "
+                              "whole run and are split across the jobs, --max-memory is split across "
+                              "the workers (default=0 (off))"),
+                     cl::init(0),
+                     cl::cat(StartCat));
+
+  cl::opt<unsigned>
+  DistributedPrefixDepth("distributed-prefix-depth",
+                         cl::desc("Number of symbolic branch decisions fixed by the path prefix of each "
+                                  "job, i.e. 2^N jobs are run. Only used with --distributed-workers "
+                                  "(default=0 (enough for four jobs per worker))"),
+                         cl::init(0),
+                         cl::cat(StartCat));
   
 
   /*** Linking options ***/
@@ -293,6 +313,9 @@ namespace {
 
 namespace klee {
 extern cl::opt<std::string> MaxTime;
+extern cl::opt<unsigned long long> MaxInstructions;
+extern cl::opt<unsigned> MaxMemory;
+extern cl::opt<std::string> TimerInterval;
 class ExecutionState;
 }
 
@@ -342,6 +365,10 @@ public:
   static void getKTestFilesInDir(std::string directoryPath,
                                  std::vector<std::string> &results);
 
+  // move the test cases of a finished distributed job into the output
+  // directory, renumbering them after the tests merged so far
+  unsigned mergeTestCases(const std::string &jobDirectory);
+
   static std::string getRunTimeLibraryPath(const char *argv0);
 };
 
@@ -420,6 +447,8 @@ KleeHandler::~KleeHandler() {
   delete m_symPathWriter;
   fclose(klee_warning_file);
   fclose(klee_message_file);
+  klee_warning_file = nullptr;
+  klee_message_file = nullptr;
 }
 
 void KleeHandler::setInterpreter(Interpreter *i) {
@@ -635,6 +664,42 @@ void KleeHandler::getKTestFilesInDir(std::string directoryPath,
   }
 }
 
+unsigned KleeHandler::mergeTestCases(const std::string &jobDirectory) {
+  // test id -> (suffix, path) of all files belonging to that test
+  std::map<unsigned, std::vector<std::pair<std::string, std::string>>> tests;
+  std::error_code ec;
+  llvm::sys::fs::directory_iterator i(jobDirectory, ec), e;
+  for (; i != e && !ec; i.increment(ec)) {
+    StringRef name = sys::path::filename(i->path());
+    if (!name.startswith("test"))
+      continue;
+    auto idAndSuffix = name.drop_front(4).split('.');
+    unsigned id;
+    if (idAndSuffix.second.empty() || idAndSuffix.first.getAsInteger(10, id))
+      continue;
+    tests[id].emplace_back(idAndSuffix.second.str(), i->path());
+  }
+
+  if (ec) {
+    klee_warning("unable to read job directory \"%s\": %s",
+                 jobDirectory.c_str(), ec.message().c_str());
+    return 0;
+  }
+
+  for (const auto &test : tests) {
+    ++m_numGeneratedTests;
+    for (const auto &file : test.second) {
+      std::string target =
+          getOutputFilename(getTestFilename(file.first, m_numGeneratedTests));
+      if (auto ec = sys::fs::rename(file.second, target))
+        klee_warning("unable to move \"%s\" to \"%s\": %s",
+                     file.second.c_str(), target.c_str(), ec.message().c_str());
+    }
+  }
+
+  return tests.size();
+}
+
 std::string KleeHandler::getRunTimeLibraryPath(const char *argv0) {
   // allow specifying the path to the runtime library
   const char *env = getenv("KLEE_RUNTIME_LIBRARY_PATH");
@@ -1009,6 +1074,12 @@ static void interrupt_handle_watchdog() {
   // just wait for the child to finish
 }
 
+static void interrupt_handle_coordinator() {
+  // the workers see the signal themselves, just stop starting new jobs
+  interrupted = true;
+  sys::SetInterruptFunction(interrupt_handle_coordinator);
+}
+
 // This is a temporary hack. If the running process has access to
 // externals then it can disable interrupts, which screws up the
 // normal "nice" watchdog termination process. We try to request the
@@ -1025,6 +1096,140 @@ static void halt_via_gdb(int pid) {
     perror("system");
 }
 
+/// Splits the exploration into 2^depth jobs, each following a different
+/// path prefix, and runs them in at most --distributed-workers concurrent
+/// worker processes. Returns true in the coordinator after all jobs have
+/// finished and their test cases were merged into its output directory.
+/// Returns false in a worker, which continues as a regular run with
+/// \p pathPrefix and --output-dir set up for its job.
+///
+/// The run limits hold for the whole run: each job gets its share of the
+/// remaining --max-time, and of --max-instructions and --max-tests, while
+/// --max-memory is shared by the concurrently running workers.
+static bool coordinateWorkers(int argc, char **argv,
+                              std::vector<bool> &pathPrefix) {
+  if (!ReplayKTestFile.empty() || !ReplayKTestDir.empty() ||
+      ReplayPathFile != "" || !SeedOutFile.empty() || !SeedOutDir.empty())
+    klee_error("--distributed-workers cannot be used together with replaying "
+               "or seeding");
+
+  // Use more jobs than workers, so that workers which finish their part of
+  // the tree early pick up further jobs.
+  unsigned depth = DistributedPrefixDepth;
+  if (!depth) {
+    while ((1u << depth) < 4 * DistributedWorkers)
+      ++depth;
+  }
+  if (depth > 16)
+    klee_error("--distributed-prefix-depth must not be larger than 16");
+  const unsigned numJobs = 1u << depth;
+
+  auto handler = std::make_unique<KleeHandler>(argc, argv);
+  for (int i = 0; i < argc; i++) {
+    handler->getInfoStream() << argv[i] << (i + 1 < argc ? " " : "\n");
+  }
+  handler->getInfoStream() << "PID: " << getpid() << "\n";
+
+  auto jobDirectory = [&](unsigned job) {
+    std::string name = "job-";
+    for (unsigned i = 0; i < depth; ++i)
+      name += ((job >> (depth - 1 - i)) & 1) ? '1' : '0';
+    return handler->getOutputFilename(name);
+  };
+
+  klee_message("distributing %u jobs to %u workers", numJobs,
+               DistributedWorkers.getValue());
+  sys::SetInterruptFunction(interrupt_handle_coordinator);
+
+  const time::Span maxTime{MaxTime};
+  const auto deadline = time::getWallTime() + maxTime;
+  auto outOfBudget = [&]() {
+    return (maxTime && time::getWallTime() >= deadline) ||
+           (MaxTests && handler->getNumTestCases() >= MaxTests);
+  };
+
+  std::map<pid_t, unsigned> running;
+  unsigned nextJob = 0, failedJobs = 0;
+  while (true) {
+    while (!interrupted && !outOfBudget() && nextJob < numJobs &&
+           running.size() < DistributedWorkers) {
+      // do not let the worker inherit unflushed output
+      fflush(nullptr);
+      handler->getInfoStream().flush();
+      llvm::errs().flush();
+
+      pid_t pid = fork();
+      if (pid < 0)
+        klee_error("unable to fork worker: %s", strerror(errno));
+      if (pid == 0) {
+        for (unsigned i = 0; i < depth; ++i)
+          pathPrefix.push_back((nextJob >> (depth - 1 - i)) & 1);
+        OutputDir = jobDirectory(nextJob);
+
+        // workers run their jobs one after another, so give this job its
+        // share of the time left until the overall deadline, in whole timer
+        // intervals as --max-time is only checked that often
+        if (maxTime) {
+          const unsigned rounds =
+              (numJobs - nextJob + DistributedWorkers - 1) / DistributedWorkers;
+          const auto now = time::getWallTime();
+          const auto share = now < deadline ? (deadline - now) / rounds
+                                            : time::Span();
+          const auto interval = time::Span(TimerInterval).toMicroseconds();
+          const auto intervals =
+              std::max<std::uint64_t>(share.toMicroseconds() / interval, 1);
+          MaxTime = std::to_string(intervals * interval) + "us";
+        }
+        if (MaxInstructions)
+          MaxInstructions = std::max(MaxInstructions / numJobs, 1ULL);
+        if (MaxTests)
+          MaxTests = std::max(MaxTests / numJobs, 1u);
+        if (MaxMemory)
+          MaxMemory = std::max(MaxMemory / DistributedWorkers, 1u);
+
+        handler.reset();
+        return false;
+      }
+      running[pid] = nextJob++;
+    }
+
+    if (running.empty())
+      break;
+
+    int status;
+    pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0) {
+      if (errno == EINTR)
+        continue;
+      klee_error("waiting for workers failed: %s", strerror(errno));
+    }
+
+    auto it = running.find(pid);
+    if (it == running.end())
+      continue;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      ++failedJobs;
+      klee_warning("worker for \"%s\" did not finish successfully",
+                   jobDirectory(it->second).c_str());
+    }
+    // merge right away, so that --max-tests stops further jobs
+    handler->mergeTestCases(jobDirectory(it->second));
+    running.erase(it);
+  }
+
+  std::stringstream stats;
+  stats << "\n";
+  stats << "KLEE: done: distributed jobs = " << nextJob << " of " << numJobs
+        << " (" << failedJobs << " failed)\n";
+  stats << "KLEE: done: generated tests = " << handler->getNumTestCases()
+        << "\n";
+
+  llvm::errs() << stats.str();
+  handler->getInfoStream() << stats.str();
+
+  return true;
+}
+
 #ifndef SUPPORT_KLEE_UCLIBC
 static void
 linkWithUclibc(StringRef libDir, std::string opt_suffix,
@@ -1232,6 +1437,10 @@ int main(int argc, char **argv, char **envp) {
     }
   }
 
+  std::vector<bool> pathPrefix;
+  if (DistributedWorkers && coordinateWorkers(argc, argv, pathPrefix))
+    return 0;
+
   sys::SetInterruptFunction(interrupt_handle);
 
   // Load the bytecode...
@@ -1419,6 +1628,10 @@ int main(int argc, char **argv, char **envp) {
     interpreter->setReplayPath(&replayPath);
   }
 
+  if (!pathPrefix.empty()) {
+    interpreter->setPathPrefix(&pathPrefix);
+  }
+
 
   auto startTime = std::time(nullptr);
   { // output clock info and start time
@@ -0,0 +1,80 @@
+//===-- CopyOnWriteArrayTest.cpp ------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/ADT/BitArray.h"
+#include "klee/ADT/CopyOnWriteArray.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+TEST(CopyOnWriteArrayTest, CopiesAreIndependent) {
+  // Spans several pages, with a partial last page
+  const unsigned size = 3 * 4096 + 17;
+  CopyOnWriteArray<uint8_t> a(size, 1);
+  ASSERT_EQ(size, a.size());
+
+  CopyOnWriteArray<uint8_t> b(a);
+  b.set(5000, 2);
+  b.set(size - 1, 3);
+  EXPECT_EQ(1, a[5000]);
+  EXPECT_EQ(1, a[size - 1]);
+  EXPECT_EQ(2, b[5000]);
+  EXPECT_EQ(3, b[size - 1]);
+
+  a.fill(4);
+  EXPECT_EQ(4, a[0]);
+  EXPECT_EQ(1, b[0]);
+  EXPECT_EQ(2, b[5000]);
+
+  CopyOnWriteArray<uint8_t> c;
+  EXPECT_TRUE(c.empty());
+  c = b;
+  b.set(5000, 5);
+  EXPECT_EQ(2, c[5000]);
+}
+
+TEST(CopyOnWriteArrayTest, BulkCopies) {
+  const unsigned size = 10000;
+  CopyOnWriteArray<uint8_t> a(size);
+  std::vector<uint8_t> buffer(size, 0);
+  EXPECT_TRUE(a.equals(buffer.data()));
+
+  buffer[9999] = 7;
+  EXPECT_FALSE(a.equals(buffer.data()));
+
+  CopyOnWriteArray<uint8_t> b(a);
+  b.copyFrom(buffer.data());
+  EXPECT_TRUE(b.equals(buffer.data()));
+  EXPECT_EQ(0, a[9999]);
+
+  std::vector<uint8_t> out(size, 1);
+  b.copyTo(out.data());
+  EXPECT_EQ(buffer, out);
+}
+
+TEST(CopyOnWriteArrayTest, BitArray) {
+  const unsigned size = 100000;
+  BitArray a(size, true);
+  a.unset(70000);
+  BitArray b(a, size);
+  b.set(70000);
+  b.unset(3);
+  EXPECT_FALSE(a.get(70000));
+  EXPECT_TRUE(a.get(3));
+  EXPECT_TRUE(b.get(70000));
+  EXPECT_FALSE(b.get(3));
+}
+
+} // namespace
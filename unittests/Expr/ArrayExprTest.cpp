@@ -45,8 +45,11 @@ TEST(ArrayExprTest, HashCollisions) {
   UpdateList ul(array, 0);
   ul.extend(getConstant(3, Expr::Int32), getConstant(11, Expr::Int8));
   ref<Expr> firstRead = ReadExpr::create(ul, symIdx);
-  ul.extend(getConstant(6, Expr::Int32), getConstant(42, Expr::Int8));
-  ul.extend(getConstant(6, Expr::Int32), getConstant(42, Expr::Int8));
+  // Add the updates directly, as extend() would drop the overwritten one
+  ul.head = new UpdateNode(ul.head, getConstant(6, Expr::Int32),
+                           getConstant(42, Expr::Int8));
+  ul.head = new UpdateNode(ul.head, getConstant(6, Expr::Int32),
+                           getConstant(42, Expr::Int8));
   ref<Expr> updatedRead = ReadExpr::create(ul, symIdx);
 
   // This test requires hash collision and should be updated if the hash
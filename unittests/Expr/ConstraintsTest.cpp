@@ -0,0 +1,139 @@
+//===-- ConstraintsTest.cpp -----------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Expr/ArrayCache.h"
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/Expr.h"
+
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+std::vector<ref<Expr>> toVector(const ConstraintSet &constraints) {
+  return std::vector<ref<Expr>>(constraints.begin(), constraints.end());
+}
+
+TEST(ConstraintsTest, SharedPrefixes) {
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 64);
+  std::vector<ref<Expr>> exprs;
+  for (unsigned i = 0; i < 64; ++i)
+    exprs.push_back(UltExpr::create(Expr::createTempRead(array, Expr::Int8),
+                                    ConstantExpr::create(i + 1, Expr::Int8)));
+
+  // Fork at every size, including chunk boundaries, and let both copies
+  // append different constraints
+  ConstraintSet parent;
+  std::vector<ref<Expr>> expected;
+  for (unsigned i = 0; i < 40; ++i) {
+    ConstraintSet left(parent), right(parent);
+    left.push_back(exprs[i]);
+    right.push_back(exprs[63 - i]);
+    right.push_back(exprs[i]);
+
+    std::vector<ref<Expr>> expectedLeft(expected), expectedRight(expected);
+    expectedLeft.push_back(exprs[i]);
+    expectedRight.push_back(exprs[63 - i]);
+    expectedRight.push_back(exprs[i]);
+    EXPECT_EQ(expected, toVector(parent));
+    EXPECT_EQ(expectedLeft, toVector(left));
+    EXPECT_EQ(expectedRight, toVector(right));
+    EXPECT_FALSE(left == right);
+
+    parent.push_back(exprs[i]);
+    expected.push_back(exprs[i]);
+    EXPECT_TRUE(parent == left);
+    EXPECT_EQ(left.hash(), parent.hash());
+  }
+
+  EXPECT_EQ(40u, parent.size());
+  EXPECT_TRUE(ConstraintSet(expected) == parent);
+  EXPECT_EQ(ConstraintSet(expected).hash(), parent.hash());
+}
+
+ref<Expr> read(const Array *array, const ref<Expr> &index) {
+  return ReadExpr::create(UpdateList(array, 0), index);
+}
+
+ref<Expr> read(const Array *array, unsigned index) {
+  return read(array, ConstantExpr::create(index, Expr::Int32));
+}
+
+std::vector<ref<Expr>> independent(const ConstraintSet &constraints,
+                                   const ref<Expr> &expr) {
+  std::vector<ref<Expr>> result;
+  constraints.getIndependentConstraints(expr, result);
+  return result;
+}
+
+TEST(ConstraintsTest, IndependentConstraints) {
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("a", 8);
+  const Array *b = ac.CreateArray("b", 8);
+  const Array *c = ac.CreateArray("c", 8);
+  ref<Expr> five = ConstantExpr::create(5, Expr::Int8);
+
+  std::vector<ref<Expr>> cs = {
+      UltExpr::create(read(a, 0), five),
+      UltExpr::create(read(b, 0), five),
+      UltExpr::create(read(a, 1), five),
+      EqExpr::create(read(a, 0), read(b, 1)),
+      UltExpr::create(read(c, ZExtExpr::create(read(a, 2), Expr::Int32)), five),
+      UltExpr::create(read(c, 0), five),
+  };
+  ConstraintSet constraints;
+  for (const auto &constraint : cs)
+    constraints.push_back(constraint);
+
+  typedef std::vector<ref<Expr>> exprs_ty;
+  EXPECT_EQ(exprs_ty({cs[0], cs[3]}),
+            independent(constraints, UgtExpr::create(read(a, 0), five)));
+  EXPECT_EQ(exprs_ty({cs[0], cs[3]}),
+            independent(constraints, UgtExpr::create(read(b, 1), five)));
+  EXPECT_EQ(exprs_ty({cs[1]}),
+            independent(constraints, UgtExpr::create(read(b, 0), five)));
+  EXPECT_EQ(exprs_ty({cs[4], cs[5]}),
+            independent(constraints, UgtExpr::create(read(c, 5), five)));
+  EXPECT_EQ(exprs_ty({cs[4], cs[5]}),
+            independent(constraints, UgtExpr::create(read(a, 2), five)));
+  EXPECT_EQ(exprs_ty(),
+            independent(constraints, UgtExpr::create(read(a, 3), five)));
+
+  std::vector<exprs_ty> factors;
+  constraints.getIndependentFactors(factors);
+  EXPECT_EQ(std::vector<exprs_ty>(
+                {{cs[0], cs[3]}, {cs[1]}, {cs[2]}, {cs[4], cs[5]}}),
+            factors);
+
+  // Extending a copy must not affect the original
+  ConstraintSet copy(constraints);
+  ref<Expr> link = EqExpr::create(read(a, 1), read(a, 0));
+  copy.push_back(link);
+  EXPECT_EQ(exprs_ty({cs[0], cs[2], cs[3], link}),
+            independent(copy, UgtExpr::create(read(a, 0), five)));
+  EXPECT_EQ(exprs_ty({cs[0], cs[3]}),
+            independent(constraints, UgtExpr::create(read(a, 0), five)));
+
+  // A symbolic read may access all elements read so far
+  ref<Expr> symbolic =
+      UltExpr::create(read(a, ZExtExpr::create(read(b, 0), Expr::Int32)), five);
+  copy.push_back(symbolic);
+  factors.clear();
+  copy.getIndependentFactors(factors);
+  EXPECT_EQ(1u, factors.size());
+  EXPECT_EQ(exprs_ty({cs[0], cs[1], cs[2], cs[3], cs[4], cs[5], link,
+                      symbolic}),
+            independent(copy, UgtExpr::create(read(a, 7), five)));
+}
+
+} // namespace
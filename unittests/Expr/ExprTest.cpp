@@ -11,9 +11,16 @@
 #include "gtest/gtest.h"
 
 #include "klee/Expr/ArrayCache.h"
+#include "klee/Expr/Assignment.h"
 #include "klee/Expr/Expr.h"
+#include "klee/System/MemoryUsage.h"
+
+#include <llvm/Support/CommandLine.h>
 
 using namespace klee;
+namespace klee {
+extern llvm::cl::opt<bool> UseExprInterning;
+}
 
 namespace {
 
@@ -264,4 +271,140 @@ TEST(ExprTest, ReadExprFoldingSymbolicIndexUpdate) {
     EXPECT_EQ(Expr::Read, read.get()->getKind());
   }
 }
+
+TEST(ExprTest, UpdateListCompaction) {
+  unsigned size = 8;
+
+  std::vector<ref<ConstantExpr> > Contents(size);
+  for (unsigned i = 0; i < size; ++i)
+    Contents[i] = ConstantExpr::create(i + 1, Expr::Int8);
+  ArrayCache ac;
+  const Array *array =
+      ac.CreateArray("arr", size, &Contents[0], &Contents[0] + size);
+  const Array *indices = ac.CreateArray("indices", 256);
+
+  // Alternate writes to a few concrete indices with writes to symbolic ones
+  UpdateList ul(array, 0);
+  std::vector<unsigned char> indexValues;
+  std::vector<uint64_t> expected(size);
+  for (unsigned i = 0; i < size; ++i)
+    expected[i] = i + 1;
+  for (unsigned i = 0; i < 200; ++i) {
+    if (i % 2) {
+      ref<Expr> byte = ReadExpr::create(
+          UpdateList(indices, 0), ConstantExpr::create(i / 2, Expr::Int32));
+      ref<Expr> index = ZExtExpr::create(
+          AndExpr::create(byte, ConstantExpr::create(size - 1, Expr::Int8)),
+          Expr::Int32);
+      indexValues.push_back(i * 7);
+      ul.extend(index, ConstantExpr::create(i, Expr::Int8));
+      expected[(i * 7) % size] = i;
+    } else {
+      ul.extend(ConstantExpr::create(i % 6 / 2, Expr::Int32),
+                ConstantExpr::create(i, Expr::Int8));
+      expected[i % 6 / 2] = i;
+    }
+  }
+
+  // Overwritten concrete writes are dropped
+  EXPECT_LT(ul.getSize(), 200u);
+  EXPECT_GE(ul.getSize(), 103u);
+
+  indexValues.resize(256);
+  std::vector<const Array *> objects{indices};
+  std::vector<std::vector<unsigned char> > values{indexValues};
+  Assignment assignment(objects, values);
+  for (unsigned i = 0; i < size; ++i) {
+    ref<Expr> read = assignment.evaluate(
+        ReadExpr::create(ul, ConstantExpr::create(i, Expr::Int32)));
+    ASSERT_EQ(Expr::Constant, read->getKind());
+    EXPECT_EQ(expected[i], cast<ConstantExpr>(read)->getZExtValue());
+  }
+}
+
+/// Restores the interning option when the test ends, even if it fails
+struct InterningGuard {
+  bool saved = UseExprInterning;
+  ~InterningGuard() { UseExprInterning = saved; }
+};
+
+TEST(ExprTest, Interning) {
+  InterningGuard guard;
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 256);
+  ref<Expr> c100 = getConstant(100, 8);
+
+  klee::UseExprInterning = true;
+  ref<Expr> add1 = AddExpr::create(Expr::createTempRead(array, 8), c100);
+  ref<Expr> add2 = AddExpr::create(Expr::createTempRead(array, 8), c100);
+  ref<Expr> sub = SubExpr::create(Expr::createTempRead(array, 8), c100);
+  EXPECT_EQ(add1.get(), add2.get());
+  EXPECT_EQ(Expr::createTempRead(array, 8).get(),
+            Expr::createTempRead(array, 8).get());
+  EXPECT_NE(add1.get(), sub.get());
+
+  // Nodes leave the table once they are released
+  sub = nullptr;
+  ref<Expr> sub1 = SubExpr::create(Expr::createTempRead(array, 8), c100);
+  ref<Expr> sub2 = SubExpr::create(Expr::createTempRead(array, 8), c100);
+  EXPECT_EQ(sub1.get(), sub2.get());
+
+  klee::UseExprInterning = false;
+  ref<Expr> add3 = AddExpr::create(Expr::createTempRead(array, 8), c100);
+  EXPECT_NE(add1.get(), add3.get());
+  EXPECT_EQ(add1, add3);
+}
+
+#ifdef ENABLE_EXPR_POOL_ALLOCATOR
+TEST(ExprTest, PoolAllocator) {
+  ArrayCache ac;
+  ref<Expr> read1 = Expr::createTempRead(ac.CreateArray("arr1", 256), 8);
+  ref<Expr> read2 = Expr::createTempRead(ac.CreateArray("arr2", 256), 8);
+
+  std::size_t allocated = ExprAllocator::getAllocatedBytes();
+  {
+    ref<Expr> add = AddExpr::create(read1, read2);
+    EXPECT_LT(allocated, ExprAllocator::getAllocatedBytes());
+  }
+  EXPECT_EQ(allocated, ExprAllocator::getAllocatedBytes());
+
+  // A freed block is reused for the next object of the same size class
+  void *p = ExprAllocator::allocate(sizeof(AddExpr));
+  std::size_t free = ExprAllocator::getFreeBytes();
+  ExprAllocator::deallocate(p, sizeof(AddExpr));
+  EXPECT_LT(free, ExprAllocator::getFreeBytes());
+  EXPECT_EQ(p, ExprAllocator::allocate(sizeof(MulExpr)));
+  EXPECT_EQ(free, ExprAllocator::getFreeBytes());
+  ExprAllocator::deallocate(p, sizeof(MulExpr));
+}
+
+TEST(ExprTest, PoolAllocatorMemoryUsage) {
+  // Memory in use as Executor::checkMemoryUsage measures it
+  auto used = [] {
+    return util::GetTotalMallocUsage() - ExprAllocator::getFreeBytes();
+  };
+  // Allowance for malloc's bookkeeping of the chunks
+  const std::size_t slack = 4096;
+
+  const std::size_t size = 64;
+  std::vector<void *> blocks;
+  blocks.reserve(1 << 16);
+  std::size_t before = used();
+
+  // Allocate until a new chunk is taken from malloc, which is then mostly
+  // unused
+  std::size_t total = util::GetTotalMallocUsage();
+  while (util::GetTotalMallocUsage() == total &&
+         blocks.size() != blocks.capacity())
+    blocks.push_back(ExprAllocator::allocate(size));
+  ASSERT_NE(blocks.size(), blocks.capacity());
+  EXPECT_LE(before + blocks.size() * size, used());
+  EXPECT_GE(before + blocks.size() * size + slack, used());
+
+  // The memory stays with the allocator, but is no longer in use
+  for (void *p : blocks)
+    ExprAllocator::deallocate(p, size);
+  EXPECT_GE(before + slack, used());
+}
+#endif
 }
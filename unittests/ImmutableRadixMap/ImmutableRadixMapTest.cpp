@@ -0,0 +1,194 @@
+//===-- ImmutableRadixMapTest.cpp -----------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/ADT/ImmutableMap.h"
+#include "klee/ADT/ImmutableRadixMap.h"
+
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <functional>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+struct Identity {
+  uint64_t operator()(uint64_t key) const { return key; }
+};
+
+typedef ImmutableRadixMap<uint64_t, int, Identity> RadixMap;
+
+void expectEqual(const std::map<uint64_t, int> &expected, const RadixMap &map) {
+  ASSERT_EQ(expected.size(), map.size());
+  auto it = map.begin();
+  for (auto const &entry : expected) {
+    ASSERT_NE(map.end(), it);
+    EXPECT_EQ(RadixMap::value_type(entry), *it);
+    ++it;
+  }
+  EXPECT_EQ(map.end(), it);
+
+  // And backwards
+  for (auto rit = expected.rbegin(), rie = expected.rend(); rit != rie; ++rit) {
+    --it;
+    EXPECT_EQ(RadixMap::value_type(*rit), *it);
+  }
+  if (!expected.empty()) {
+    EXPECT_EQ(map.begin(), it);
+  }
+}
+
+// Heap-like addresses: clustered, with a few far away regions
+uint64_t randomAddress(std::mt19937_64 &rng) {
+  static const uint64_t bases[] = {0x10000, 0x55d4a0000000, 0x7ffc12340000};
+  return bases[rng() % 3] + (rng() % 4096) * 16;
+}
+} // namespace
+
+TEST(ImmutableRadixMapTest, MatchesStdMap) {
+  std::mt19937_64 rng(7);
+  std::map<uint64_t, int> expected;
+  RadixMap map;
+  std::vector<std::pair<std::map<uint64_t, int>, RadixMap> > versions;
+
+  for (int i = 0; i < 5000; ++i) {
+    uint64_t key = randomAddress(rng);
+    switch (rng() % 4) {
+    case 0:
+      expected.insert(std::make_pair(key, i));
+      map = map.insert(std::make_pair(key, i));
+      break;
+    case 1:
+      expected[key] = i;
+      map = map.replace(std::make_pair(key, i));
+      break;
+    case 2:
+      expected.erase(key);
+      map = map.remove(key);
+      break;
+    case 3: {
+      auto eit = expected.upper_bound(key);
+      auto it = map.upper_bound(key);
+      EXPECT_EQ(eit == expected.end(), it == map.end());
+      if (eit != expected.end() && it != map.end()) {
+        EXPECT_EQ(RadixMap::value_type(*eit), *it);
+      }
+
+      eit = expected.lower_bound(key);
+      it = map.lower_bound(key);
+      EXPECT_EQ(eit == expected.end(), it == map.end());
+      if (eit != expected.end() && it != map.end()) {
+        EXPECT_EQ(RadixMap::value_type(*eit), *it);
+      }
+
+      auto previous = expected.upper_bound(key);
+      const RadixMap::value_type *res = map.lookup_previous(key);
+      if (previous == expected.begin()) {
+        EXPECT_EQ(nullptr, res);
+      } else {
+        --previous;
+        ASSERT_NE(nullptr, res);
+        EXPECT_EQ(RadixMap::value_type(*previous), *res);
+      }
+      break;
+    }
+    }
+
+    EXPECT_EQ(expected.count(key), map.count(key));
+    const RadixMap::value_type *res = map.lookup(key);
+    if (expected.count(key)) {
+      ASSERT_NE(nullptr, res);
+      EXPECT_EQ(expected[key], res->second);
+    } else {
+      EXPECT_EQ(nullptr, res);
+    }
+
+    if (i % 500 == 0)
+      versions.push_back(std::make_pair(expected, map));
+  }
+
+  expectEqual(expected, map);
+  // Older versions are not affected by later updates
+  for (auto const &version : versions)
+    expectEqual(version.first, version.second);
+}
+
+TEST(ImmutableRadixMapTest, ExtremeKeys) {
+  RadixMap map;
+  map = map.insert(std::make_pair(~0ULL, 1));
+  map = map.insert(std::make_pair(0ULL, 2));
+  map = map.insert(std::make_pair(1ULL << 63, 3));
+
+  EXPECT_EQ(3u, map.size());
+  EXPECT_EQ(0ULL, map.min().first);
+  EXPECT_EQ(~0ULL, map.max().first);
+  EXPECT_EQ(1ULL << 63, map.lookup_previous(~0ULL - 1)->first);
+  EXPECT_EQ(map.end(), map.upper_bound(~0ULL));
+
+  map = map.remove(1ULL << 63).remove(0);
+  EXPECT_EQ(1u, map.size());
+  EXPECT_EQ(nullptr, map.lookup_previous(5));
+}
+
+// Compares lookups, updates and copies with ImmutableMap. Run with
+// --gtest_also_run_disabled_tests.
+TEST(ImmutableRadixMapTest, DISABLED_Benchmark) {
+  for (unsigned size : {100u, 1000u, 10000u, 100000u}) {
+    std::mt19937_64 rng(size);
+    std::vector<uint64_t> keys;
+    for (unsigned i = 0; i < size; ++i)
+      keys.push_back(0x55d4a0000000 + (rng() % (size * 64)) * 16);
+
+    ImmutableMap<uint64_t, int> tree;
+    RadixMap radix;
+    for (unsigned i = 0; i < size; ++i) {
+      tree = tree.replace(std::make_pair(keys[i], i));
+      radix = radix.replace(std::make_pair(keys[i], i));
+    }
+
+    const unsigned rounds = 1000000;
+    auto measure = [&](const char *what, const std::function<void()> &f) {
+      auto start = std::chrono::steady_clock::now();
+      f();
+      auto end = std::chrono::steady_clock::now();
+      std::cout << size << " objects, " << what << ": "
+                << std::chrono::duration<double, std::nano>(end - start)
+                           .count() / rounds
+                << " ns\n";
+    };
+
+    uint64_t sum = 0;
+    measure("ImmutableMap lookup_previous", [&]() {
+      for (unsigned i = 0; i < rounds; ++i)
+        sum += tree.lookup_previous(keys[i % size] + 8)->second;
+    });
+    measure("ImmutableRadixMap lookup_previous", [&]() {
+      for (unsigned i = 0; i < rounds; ++i)
+        sum += radix.lookup_previous(keys[i % size] + 8)->second;
+    });
+    measure("ImmutableMap fork and replace", [&]() {
+      for (unsigned i = 0; i < rounds; ++i) {
+        ImmutableMap<uint64_t, int> copy(tree);
+        copy = copy.replace(std::make_pair(keys[i % size], i));
+      }
+    });
+    measure("ImmutableRadixMap fork and replace", [&]() {
+      for (unsigned i = 0; i < rounds; ++i) {
+        RadixMap copy(radix);
+        copy = copy.replace(std::make_pair(keys[i % size], i));
+      }
+    });
+    EXPECT_NE(0u, sum);
+  }
+}
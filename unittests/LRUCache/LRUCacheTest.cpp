@@ -0,0 +1,55 @@
+//===-- LRUCacheTest.cpp --------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/ADT/LRUCache.h"
+
+#include "gtest/gtest.h"
+
+#include <string>
+
+using namespace klee;
+
+namespace {
+
+TEST(LRUCacheTest, EvictsLeastRecentlyUsed) {
+  LRUCache<int, std::string> cache(3);
+  cache.insert(1, "a");
+  cache.insert(2, "b");
+  cache.insert(3, "c");
+  ASSERT_EQ(3u, cache.size());
+
+  // A lookup makes 1 the most recently used entry
+  ASSERT_NE(nullptr, cache.find(1));
+  cache.insert(4, "d");
+  EXPECT_EQ(3u, cache.size());
+  EXPECT_EQ(nullptr, cache.find(2));
+  ASSERT_NE(nullptr, cache.find(1));
+  EXPECT_EQ("a", *cache.find(1));
+
+  // Replacing a value counts as a use, too
+  cache.insert(3, "e");
+  cache.insert(5, "f");
+  EXPECT_EQ(nullptr, cache.find(4));
+  ASSERT_NE(nullptr, cache.find(3));
+  EXPECT_EQ("e", *cache.find(3));
+  EXPECT_NE(nullptr, cache.find(5));
+
+  cache.clear();
+  EXPECT_EQ(0u, cache.size());
+  EXPECT_EQ(nullptr, cache.find(1));
+}
+
+TEST(LRUCacheTest, ZeroCapacity) {
+  LRUCache<int, int> cache(0);
+  cache.insert(1, 1);
+  EXPECT_EQ(0u, cache.size());
+  EXPECT_EQ(nullptr, cache.find(1));
+}
+
+}
@@ -0,0 +1,115 @@
+//===-- MapOfSetsTest.cpp -------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/ADT/MapOfSets.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+typedef std::set<unsigned> Set;
+
+bool includes(const Set &a, const Set &b) {
+  return std::includes(a.begin(), a.end(), b.begin(), b.end());
+}
+
+// Path conditions: every set extends a prefix of an earlier one, which is
+// what the counterexample cache sees during exploration
+std::vector<Set> makePathSets(std::mt19937 &rng, unsigned count,
+                              unsigned universe) {
+  std::vector<Set> sets;
+  for (unsigned i = 0; i < count; ++i) {
+    Set s;
+    if (!sets.empty()) {
+      const Set &parent = sets[rng() % sets.size()];
+      auto end = parent.begin();
+      std::advance(end, rng() % (parent.size() + 1));
+      s.insert(parent.begin(), end);
+    }
+    for (unsigned n = 1 + rng() % 3; n; --n)
+      s.insert(rng() % universe);
+    sets.push_back(s);
+  }
+  return sets;
+}
+} // namespace
+
+TEST(MapOfSetsTest, MatchesBruteForce) {
+  std::mt19937 rng(42);
+  std::vector<Set> sets = makePathSets(rng, 2000, 64);
+
+  MapOfSets<unsigned, int> map;
+  for (unsigned i = 0; i < sets.size(); ++i)
+    map.insert(sets[i], i);
+
+  for (unsigned round = 0; round < 500; ++round) {
+    Set key;
+    for (unsigned n = rng() % 12; n; --n)
+      key.insert(rng() % 64);
+    // Odd values only, so that the predicate rejects some matches
+    auto odd = [](int v) { return v % 2 == 1; };
+
+    bool hasSuperset = false, hasSubset = false;
+    for (unsigned i = 0; i < sets.size(); ++i) {
+      if (map.lookup(sets[i]) && !odd(*map.lookup(sets[i])))
+        continue;
+      hasSuperset |= includes(sets[i], key);
+      hasSubset |= includes(key, sets[i]);
+    }
+
+    int *superset = map.findSuperset(key, odd);
+    EXPECT_EQ(hasSuperset, superset != nullptr);
+    if (superset) {
+      EXPECT_TRUE(odd(*superset));
+      EXPECT_TRUE(includes(sets[*superset], key));
+    }
+
+    int *subset = map.findSubset(key, odd);
+    EXPECT_EQ(hasSubset, subset != nullptr);
+    if (subset) {
+      EXPECT_TRUE(odd(*subset));
+      EXPECT_TRUE(includes(key, sets[*subset]));
+    }
+  }
+}
+
+// Measures the cost of a lookup as the cache grows, which should stay
+// roughly flat. Run with --gtest_also_run_disabled_tests.
+TEST(MapOfSetsTest, DISABLED_LookupBenchmark) {
+  std::mt19937 rng(42);
+  const unsigned universe = 4096;
+  std::vector<Set> sets = makePathSets(rng, 100000, universe);
+  std::vector<Set> queries = makePathSets(rng, 2000, universe);
+  auto never = [](int) { return false; };
+
+  MapOfSets<unsigned, int> map;
+  unsigned inserted = 0;
+  for (unsigned size = 1000; size <= sets.size(); size *= 10) {
+    for (; inserted < size; ++inserted)
+      map.insert(sets[inserted], inserted);
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto const &query : queries) {
+      map.findSuperset(query, never);
+      map.findSubset(query, never);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double us = std::chrono::duration<double, std::micro>(end - start).count();
+    std::cout << size << " sets: " << us / queries.size() << " us/lookup\n";
+  }
+}
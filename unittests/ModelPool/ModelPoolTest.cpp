@@ -0,0 +1,90 @@
+//===-- ModelPoolTest.cpp -------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "Core/ModelPool.h"
+
+#include "klee/Expr/ArrayCache.h"
+#include "klee/Expr/Expr.h"
+
+using namespace klee;
+
+namespace {
+
+ref<Expr> read(const Array *array, unsigned index) {
+  return ReadExpr::create(UpdateList(array, 0),
+                          ConstantExpr::create(index, Expr::Int32));
+}
+
+std::shared_ptr<const Assignment> model(const Array *array,
+                                        std::vector<unsigned char> values) {
+  auto a = std::make_shared<Assignment>();
+  a->bindings[array] = std::move(values);
+  return a;
+}
+
+TEST(ModelPoolTest, EvaluateAndRestrict) {
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("a", 2);
+  ref<Expr> isSmall =
+      UltExpr::create(read(a, 0), ConstantExpr::create(10, Expr::Int8));
+
+  ModelPool pool;
+  bool canBeTrue, canBeFalse;
+  pool.evaluate(isSmall, canBeTrue, canBeFalse);
+  EXPECT_FALSE(canBeTrue || canBeFalse);
+
+  // Unbound arrays are 0
+  pool.add(std::make_shared<Assignment>(), 2);
+  pool.evaluate(isSmall, canBeTrue, canBeFalse);
+  EXPECT_TRUE(canBeTrue);
+  EXPECT_FALSE(canBeFalse);
+
+  pool.add(model(a, {20, 0}), 2);
+  pool.evaluate(isSmall, canBeTrue, canBeFalse);
+  EXPECT_TRUE(canBeTrue && canBeFalse);
+
+  // The oldest model is dropped beyond capacity
+  pool.add(model(a, {30, 0}), 2);
+  EXPECT_EQ(2u, pool.size());
+  pool.evaluate(isSmall, canBeTrue, canBeFalse);
+  EXPECT_FALSE(canBeTrue);
+
+  pool.add(model(a, {5, 0}), 2);
+  pool.restrict(isSmall);
+  ASSERT_EQ(1u, pool.size());
+  EXPECT_EQ(5, pool.front()->bindings.at(a)[0]);
+}
+
+TEST(ModelPoolTest, Merge) {
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("a", 2);
+  const Array *b = ac.CreateArray("b", 2);
+  Assignment base, found;
+  base.bindings[a] = {1, 2};
+  base.bindings[b] = {3, 4};
+  found.bindings[a] = {5, 6};
+  found.bindings[b] = {7, 8};
+
+  // Only the elements that are read are taken from the new model
+  ref<Expr> readA1 = read(a, 1);
+  auto merged = ModelPool::merge(base, found, {readA1});
+  EXPECT_EQ((std::vector<unsigned char>{1, 6}), merged->bindings.at(a));
+  EXPECT_EQ((std::vector<unsigned char>{3, 4}), merged->bindings.at(b));
+
+  // All elements may be read at a symbolic index
+  ref<Expr> readB = ReadExpr::create(UpdateList(b, 0),
+                                     ZExtExpr::create(readA1, Expr::Int32));
+  merged = ModelPool::merge(base, found, {readB});
+  EXPECT_EQ((std::vector<unsigned char>{1, 6}), merged->bindings.at(a));
+  EXPECT_EQ((std::vector<unsigned char>{7, 8}), merged->bindings.at(b));
+}
+
+} // namespace
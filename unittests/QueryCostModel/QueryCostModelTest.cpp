@@ -0,0 +1,79 @@
+//===-- QueryCostModelTest.cpp --------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "Core/QueryCostModel.h"
+
+#include "klee/Expr/ArrayCache.h"
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/Expr.h"
+
+using namespace klee;
+
+namespace {
+
+ref<Expr> read(const UpdateList &ul, unsigned index) {
+  return ReadExpr::create(ul, ConstantExpr::create(index, Expr::Int32));
+}
+
+TEST(QueryCostModelTest, Features) {
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("a", 4);
+  const Array *b = ac.CreateArray("b", 4);
+  UpdateList ua(a, 0), ub(b, 0);
+  ub.extend(ZExtExpr::create(read(ua, 3), Expr::Int32), read(ua, 2));
+
+  ConstraintSet constraints;
+  ConstraintManager cm(constraints);
+  cm.addConstraint(UltExpr::create(read(ua, 0), read(ua, 1)));
+  // Independent of the query
+  cm.addConstraint(
+      EqExpr::create(read(UpdateList(b, 0), 3),
+                     ConstantExpr::create(7, Expr::Int8)));
+
+  ref<Expr> query = EqExpr::create(
+      MulExpr::create(read(ua, 0), read(ub, 1)),
+      MulExpr::create(read(ua, 1), ConstantExpr::create(3, Expr::Int8)));
+
+  QueryFeatures f(constraints, query);
+  EXPECT_EQ(1u, f.values[QueryFeatures::Constraints]);
+  EXPECT_EQ(2u, f.values[QueryFeatures::Arrays]);
+  EXPECT_EQ(1u, f.values[QueryFeatures::UpdateDepth]);
+  EXPECT_EQ(1u, f.values[QueryFeatures::Nonlinear]);
+  EXPECT_EQ(32u, f.values[QueryFeatures::MaxWidth]);
+}
+
+TEST(QueryCostModelTest, LearnsCostOfLargerQueries) {
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("a", 64);
+  UpdateList ul(a, 0);
+
+  // Queries summing n bytes, each taking n^2 milliseconds
+  std::vector<QueryFeatures> queries;
+  ref<Expr> sum = read(ul, 0);
+  for (unsigned n = 1; n < 64; ++n) {
+    sum = AddExpr::create(sum, read(ul, n));
+    queries.emplace_back(ConstraintSet(),
+                         EqExpr::create(sum, ConstantExpr::create(0, Expr::Int8)));
+  }
+
+  QueryCostModel model;
+  EXPECT_EQ(time::Span(), model.predict(queries.back()));
+  for (unsigned round = 0; round < 20; ++round)
+    for (unsigned n = 1; n < 64; ++n)
+      model.update(queries[n - 1], time::milliseconds(n * n));
+
+  time::Span small = model.predict(queries[3]);
+  time::Span large = model.predict(queries[59]);
+  EXPECT_LT(small, time::milliseconds(100));
+  EXPECT_GT(large, time::milliseconds(1000));
+}
+
+}
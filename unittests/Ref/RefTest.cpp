@@ -13,7 +13,10 @@
 
 #include "klee/ADT/Ref.h"
 #include "gtest/gtest.h"
+#include <chrono>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 using klee::ref;
 
@@ -172,3 +175,61 @@ TEST(RefTest, SelfRef) {
   r_root = r_root->next_;
   EXPECT_EQ(2u, r_e_1->_refCount.getCount());
 }
+
+#ifdef ENABLE_ATOMIC_REFCOUNT
+TEST(RefTest, ConcurrentCopies) {
+  finished = 0;
+  finished_counter = 0;
+  {
+    ref<Expr> r(new Expr());
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < 4; ++t)
+      threads.emplace_back([&r] {
+        for (unsigned i = 0; i < 100000; ++i) {
+          ref<Expr> copy(r);
+          ref<Expr> other;
+          other = copy;
+        }
+      });
+    for (auto &t : threads)
+      t.join();
+    EXPECT_EQ(1u, r->_refCount.getCount());
+    finished = 1;
+  }
+  EXPECT_EQ(1, finished_counter);
+}
+#endif
+
+// Measures the reference counting hot path. Compare the numbers of builds
+// with and without ENABLE_ATOMIC_REFCOUNT; run with
+// --gtest_also_run_disabled_tests.
+TEST(RefTest, DISABLED_CopyBenchmark) {
+  finished = 0;
+  finished_counter = 0;
+  {
+    ref<Expr> r(new Expr());
+    std::vector<ref<Expr>> copies(1024);
+    const unsigned rounds = 100000;
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < rounds; ++i)
+      for (auto &copy : copies)
+        copy = r; // one increment and one decrement
+    auto end = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+#ifdef ENABLE_ATOMIC_REFCOUNT
+    std::cout << "atomic";
+#else
+    std::cout << "non-atomic";
+#endif
+    std::cout << " ref<> copy assignment: "
+              << ns / (static_cast<double>(rounds) * copies.size())
+              << " ns\n";
+
+    copies.clear();
+    EXPECT_EQ(1u, r->_refCount.getCount());
+    finished = 1;
+  }
+  EXPECT_EQ(1, finished_counter);
+}
@@ -201,6 +201,48 @@ TEST(SearcherTest, TwoRandomPathDot) {
   processTree.remove(es1.ptreeNode);
   processTree.remove(root.ptreeNode);
 }
+
+TEST(SearcherTest, Deferring) {
+  ExecutionState es1, es2;
+  DeferringSearcher ds(new DFSSearcher(), time::milliseconds(100));
+  EXPECT_TRUE(ds.empty());
+
+  ds.update(nullptr, {&es1, &es2}, {});
+  EXPECT_EQ(&ds.selectState(), &es2);
+
+  // A deferred state is only selected once no other state is left
+  ds.deferState(es2);
+  ++es2.deferredBranchQueries;
+  ds.update(&es2, {}, {});
+  EXPECT_EQ(&ds.selectState(), &es1);
+  ds.deferState(es1);
+  ++es1.deferredBranchQueries;
+  ds.update(&es1, {}, {});
+  EXPECT_FALSE(ds.empty());
+
+  // Time slices double for every deferral, up to the maximum timeout
+  bool lastAttempt;
+  EXPECT_EQ(time::milliseconds(200),
+            ds.getTimeSlice(es1, time::seconds(1), lastAttempt));
+  EXPECT_FALSE(lastAttempt);
+  es1.deferredBranchQueries = 3;
+  EXPECT_EQ(time::milliseconds(800),
+            ds.getTimeSlice(es1, time::Span(), lastAttempt));
+  EXPECT_FALSE(lastAttempt);
+  EXPECT_EQ(time::milliseconds(500),
+            ds.getTimeSlice(es1, time::milliseconds(500), lastAttempt));
+  EXPECT_TRUE(lastAttempt);
+
+  // Deferred states may be removed
+  ExecutionState &selected = ds.selectState();
+  ds.deferState(selected);
+  ds.update(nullptr, {}, {&selected});
+  ExecutionState &other = &selected == &es1 ? es2 : es1;
+  EXPECT_EQ(&ds.selectState(), &other);
+  ds.update(&other, {}, {&other});
+  EXPECT_TRUE(ds.empty());
+}
+
 TEST(SearcherDeathTest, TooManyRandomPaths) {
   // First state
   ExecutionState es;
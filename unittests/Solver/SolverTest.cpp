@@ -15,8 +15,11 @@
 #include "klee/Solver/Solver.h"
 #include "klee/Solver/SolverCmdLine.h"
 
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
 
+#include <fstream>
 #include <iostream>
 
 using namespace klee;
@@ -169,4 +172,251 @@ TEST(SolverTest, Evaluation) {
   delete solver;
 }
 
+TEST(SolverTest, Portfolio) {
+  // The dummy solver always fails, so every answer has to come from the
+  // configured core solver
+  Solver *solver = createPortfolioSolver(
+      {{DUMMY_SOLVER, createDummySolver()},
+       {CoreSolverToUse, klee::createCoreSolver(CoreSolverToUse)}});
+
+  testOpcode<SelectExpr>(*solver);
+  testOpcode<AddExpr>(*solver);
+  testOpcode<UDivExpr>(*solver, false, false, 8);
+  testOpcode<EqExpr>(*solver);
+  testOpcode<SltExpr>(*solver);
+
+  delete solver;
+}
+
+TEST(SolverTest, MayBeTrueBatch) {
+  const Array *array = ac.CreateArray("batch", 1);
+  const Array *other = ac.CreateArray("batch_other", 1);
+  ref<Expr> x = Expr::createTempRead(array, Expr::Int8);
+  ref<Expr> y = Expr::createTempRead(other, Expr::Int8);
+  ConstraintSet constraints;
+  ConstraintManager cm(constraints);
+  cm.addConstraint(UltExpr::create(x, ConstantExpr::create(10, Expr::Int8)));
+  cm.addConstraint(UltExpr::create(ConstantExpr::create(200, Expr::Int8), y));
+
+  std::vector<ref<Expr> > exprs;
+  for (unsigned value : {3, 20, 5, 200, 9})
+    exprs.push_back(EqExpr::create(x, ConstantExpr::create(value, Expr::Int8)));
+  exprs.push_back(ConstantExpr::alloc(1, Expr::Bool));
+  exprs.push_back(UltExpr::create(x, ConstantExpr::create(5, Expr::Int8)));
+  // independent of the constraints on x
+  for (unsigned value : {250, 100})
+    exprs.push_back(EqExpr::create(y, ConstantExpr::create(value, Expr::Int8)));
+  exprs.push_back(EqExpr::create(x, y));
+
+  // the core solver alone, and behind the layers that forward batches
+  Solver *core = klee::createCoreSolver(CoreSolverToUse);
+  Solver *chain = klee::createCoreSolver(CoreSolverToUse);
+  chain = createCexCachingSolver(chain);
+  chain = createCachingSolver(chain);
+  chain = createIndependentSolver(chain);
+
+  for (Solver *solver : {core, chain}) {
+    // the second round is answered from the caches of the chain
+    for (unsigned round = 0; round < 2; ++round) {
+      std::vector<bool> results;
+      ASSERT_TRUE(solver->mayBeTrue(constraints, exprs, results));
+      ASSERT_EQ(exprs.size(), results.size());
+      for (std::size_t i = 0; i < exprs.size(); ++i) {
+        bool mayBeTrue;
+        ASSERT_TRUE(solver->mayBeTrue(Query(constraints, exprs[i]), mayBeTrue));
+        EXPECT_EQ(mayBeTrue, results[i]) << "expression " << i;
+      }
+    }
+  }
+
+  delete core;
+  delete chain;
+}
+
+TEST(SolverTest, PersistentCache) {
+  llvm::SmallString<128> path;
+  ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("klee-query-cache", "bin",
+                                                  path));
+
+  auto ask = [](Solver &solver, const char *name, bool &mustBeTrue,
+                std::vector<unsigned char> &value) {
+    const Array *array = ac.CreateArray(name, 1);
+    ref<Expr> x = Expr::createTempRead(array, Expr::Int8);
+    ConstraintSet constraints;
+    ConstraintManager cm(constraints);
+    cm.addConstraint(UltExpr::create(ConstantExpr::create(5, Expr::Int8), x));
+
+    if (!solver.mustBeTrue(
+            Query(constraints,
+                  UltExpr::create(ConstantExpr::create(3, Expr::Int8), x)),
+            mustBeTrue))
+      return false;
+
+    cm.addConstraint(EqExpr::create(ConstantExpr::create(7, Expr::Int8), x));
+    std::vector<const Array *> objects{array};
+    std::vector<std::vector<unsigned char> > values;
+    if (!solver.getInitialValues(
+            Query(constraints, ConstantExpr::alloc(0, Expr::Bool)), objects,
+            values))
+      return false;
+    value = values.front();
+    return true;
+  };
+
+  bool mustBeTrue;
+  std::vector<unsigned char> value;
+  Solver *solver = createPersistentCachingSolver(
+      klee::createCoreSolver(CoreSolverToUse), path.str().str());
+  ASSERT_TRUE(ask(*solver, "persistent_a", mustBeTrue, value));
+  EXPECT_TRUE(mustBeTrue);
+  EXPECT_EQ(std::vector<unsigned char>{7}, value);
+  delete solver;
+
+  // The dummy solver always fails, so the answers have to come from the file,
+  // even though the array is named differently
+  solver = createPersistentCachingSolver(createDummySolver(), path.str().str());
+  mustBeTrue = false;
+  value.clear();
+  ASSERT_TRUE(ask(*solver, "persistent_b", mustBeTrue, value));
+  EXPECT_TRUE(mustBeTrue);
+  EXPECT_EQ(std::vector<unsigned char>{7}, value);
+  delete solver;
+
+  llvm::sys::fs::remove(path);
+}
+
+TEST(SolverTest, PersistentCacheTornRecord) {
+  llvm::SmallString<128> path;
+  ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("klee-query-cache", "bin",
+                                                  path));
+
+  auto ask = [](Solver &solver, uint64_t bound, bool &mustBeTrue) {
+    const Array *array = ac.CreateArray("torn", 1);
+    ref<Expr> x = Expr::createTempRead(array, Expr::Int8);
+    ConstraintSet constraints;
+    ConstraintManager cm(constraints);
+    cm.addConstraint(UltExpr::create(ConstantExpr::create(5, Expr::Int8), x));
+    return solver.mustBeTrue(
+        Query(constraints,
+              UltExpr::create(ConstantExpr::create(bound, Expr::Int8), x)),
+        mustBeTrue);
+  };
+
+  bool mustBeTrue;
+  Solver *solver = createPersistentCachingSolver(
+      klee::createCoreSolver(CoreSolverToUse), path.str().str());
+  ASSERT_TRUE(ask(*solver, 3, mustBeTrue));
+  delete solver;
+
+  // A record whose writer died halfway, followed by more records
+  {
+    std::ofstream file(path.str().str(),
+                       std::ios::binary | std::ios::out | std::ios::app);
+    ASSERT_TRUE(file.good());
+    const char torn[] = "KQR\xA5\x40\0\0\0\0\0\0\0partial";
+    file.write(torn, sizeof(torn) - 1);
+  }
+  solver = createPersistentCachingSolver(
+      klee::createCoreSolver(CoreSolverToUse), path.str().str());
+  ASSERT_TRUE(ask(*solver, 7, mustBeTrue));
+  delete solver;
+
+  // The dummy solver always fails, so both answers have to come from the file
+  solver = createPersistentCachingSolver(createDummySolver(), path.str().str());
+  ASSERT_TRUE(ask(*solver, 3, mustBeTrue));
+  EXPECT_TRUE(mustBeTrue);
+  ASSERT_TRUE(ask(*solver, 7, mustBeTrue));
+  EXPECT_FALSE(mustBeTrue);
+  delete solver;
+
+  llvm::sys::fs::remove(path);
+}
+
+TEST(SolverTest, BitRange) {
+  // The dummy solver always fails, so every answer has to come from the
+  // bit range solver
+  Solver *solver = createBitRangeSolver(createDummySolver());
+  auto C = [](uint64_t value, Expr::Width width = Expr::Int32) {
+    return ConstantExpr::create(value, width);
+  };
+
+  const Array *array = ac.CreateArray("bitrange_x", 4);
+  ref<Expr> x = Expr::createTempRead(array, Expr::Int32);
+  ConstraintSet constraints;
+  ConstraintManager cm(constraints);
+  cm.addConstraint(UltExpr::create(x, C(10)));
+
+  bool result;
+  ASSERT_TRUE(solver->mustBeTrue(Query(constraints, UltExpr::create(x, C(20))),
+                                 result));
+  EXPECT_TRUE(result);
+  ASSERT_TRUE(solver->mayBeTrue(
+      Query(constraints, EqExpr::create(x, C(200))), result));
+  EXPECT_FALSE(result);
+  Solver::Validity validity;
+  ASSERT_TRUE(
+      solver->evaluate(Query(constraints, EqExpr::create(x, C(5))), validity));
+  EXPECT_EQ(Solver::Unknown, validity);
+
+  cm.addConstraint(EqExpr::create(C(7), x));
+  std::vector<const Array *> objects{array};
+  std::vector<std::vector<unsigned char> > values;
+  ASSERT_TRUE(solver->getInitialValues(
+      Query(constraints, ConstantExpr::alloc(0, Expr::Bool)), objects, values));
+  EXPECT_EQ((std::vector<unsigned char>{7, 0, 0, 0}), values.front());
+
+  // Reads through a concrete update of a symbolic value
+  const Array *y = ac.CreateArray("bitrange_y", 1);
+  ref<Expr> yValue = Expr::createTempRead(y, Expr::Int8);
+  const Array *buffer = ac.CreateArray("bitrange_buffer", 4);
+  UpdateList ul(buffer, nullptr);
+  ul.extend(C(1), yValue);
+  ConstraintSet yConstraints;
+  ConstraintManager ycm(yConstraints);
+  ycm.addConstraint(UltExpr::create(C(100, Expr::Int8), yValue));
+  ASSERT_TRUE(solver->mustBeTrue(
+      Query(yConstraints,
+            UltExpr::create(C(50, Expr::Int8), ReadExpr::create(ul, C(1)))),
+      result));
+  EXPECT_TRUE(result);
+
+  // Reads at a symbolic index from a constant array
+  std::vector<ref<ConstantExpr> > table{C(1, Expr::Int8), C(2, Expr::Int8),
+                                        C(3, Expr::Int8), C(4, Expr::Int8)};
+  const Array *constant =
+      ac.CreateArray("bitrange_table", 4, &table[0], &table[0] + 4);
+  ref<Expr> index = Expr::createTempRead(ac.CreateArray("bitrange_i", 4),
+                                         Expr::Int32);
+  ConstraintSet iConstraints;
+  ConstraintManager icm(iConstraints);
+  icm.addConstraint(UltExpr::create(index, C(4)));
+  ref<Expr> read = ReadExpr::create(UpdateList(constant, nullptr), index);
+  ASSERT_TRUE(solver->mustBeTrue(
+      Query(iConstraints, UltExpr::create(C(0, Expr::Int8), read)), result));
+  EXPECT_TRUE(result);
+  ASSERT_TRUE(solver->mayBeTrue(
+      Query(iConstraints, EqExpr::create(C(4, Expr::Int8), read)), result));
+  EXPECT_TRUE(result);
+
+  // Reads that may be out of bounds may return anything
+  const Array *zeros = ac.CreateArray("bitrange_zeros", 4);
+  UpdateList zeroUpdates(zeros, nullptr);
+  ConstraintSet zConstraints;
+  ConstraintManager zcm(zConstraints);
+  for (unsigned i = 0; i != 4; ++i)
+    zcm.addConstraint(EqExpr::create(
+        C(0, Expr::Int8), ReadExpr::create(zeroUpdates, C(i))));
+  ref<Expr> masked = AndExpr::create(
+      ZExtExpr::create(
+          Expr::createTempRead(ac.CreateArray("bitrange_j", 1), Expr::Int8),
+          Expr::Int32),
+      C(7));
+  ref<Expr> oob = EqExpr::create(C(0, Expr::Int8),
+                                 ReadExpr::create(zeroUpdates, masked));
+  EXPECT_FALSE(solver->mustBeTrue(Query(zConstraints, oob), result) &&
+               result);
+
+  delete solver;
+}
+
 }
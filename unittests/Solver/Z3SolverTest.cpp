@@ -19,10 +19,22 @@
 #include "klee/Expr/Expr.h"
 #include "klee/Solver/Solver.h"
 
+#include "llvm/Support/CommandLine.h"
+
 using namespace klee;
 
+namespace klee {
+extern llvm::cl::opt<bool> Z3Incremental;
+}
+
 namespace {
 ArrayCache AC;
+
+/// Restores the incremental mode option when the test ends, even if it fails
+struct IncrementalGuard {
+  bool saved = Z3Incremental;
+  ~IncrementalGuard() { Z3Incremental = saved; }
+};
 }
 class Z3SolverTest : public ::testing::Test {
 protected:
@@ -69,3 +81,61 @@ TEST_F(Z3SolverTest, GetConstraintLog) {
   ASSERT_STRNE(Occurence, nullptr);
   free(ConstraintsString);
 }
+
+TEST_F(Z3SolverTest, Incremental) {
+  IncrementalGuard guard;
+  Z3Incremental = true;
+
+  const Array *Arr = AC.CreateArray("incremental_arr", 1);
+  const ref<Expr> X = Expr::createTempRead(Arr, Expr::Int8);
+  auto C = [](uint64_t Value) { return ConstantExpr::alloc(Value, Expr::Int8); };
+
+  ConstraintSet Constraints;
+  ConstraintManager cm(Constraints);
+  cm.addConstraint(UgtExpr::create(X, C(5)));
+
+  bool Result;
+  ASSERT_TRUE(Z3Solver_->mustBeTrue(Query(Constraints, UgtExpr::create(X, C(3))),
+                                    Result));
+  EXPECT_TRUE(Result);
+
+  // Extends the previous constraints
+  cm.addConstraint(UltExpr::create(X, C(10)));
+  ASSERT_TRUE(Z3Solver_->mustBeTrue(Query(Constraints, UltExpr::create(X, C(9))),
+                                    Result));
+  EXPECT_FALSE(Result);
+  ASSERT_TRUE(Z3Solver_->mustBeTrue(Query(Constraints, UltExpr::create(X, C(10))),
+                                    Result));
+  EXPECT_TRUE(Result);
+
+  // Shares a prefix with the previous constraints, then diverges
+  ConstraintSet Sibling;
+  ConstraintManager siblingCM(Sibling);
+  siblingCM.addConstraint(UgtExpr::create(X, C(5)));
+  siblingCM.addConstraint(UgeExpr::create(X, C(10)));
+  ref<ConstantExpr> Value;
+  ASSERT_TRUE(Z3Solver_->getValue(Query(Sibling, X), Value));
+  EXPECT_LE(10u, Value->getZExtValue());
+
+  // Shares nothing with the previous constraints
+  ConstraintSet Unrelated;
+  ConstraintManager unrelatedCM(Unrelated);
+  unrelatedCM.addConstraint(UltExpr::create(X, C(2)));
+  ASSERT_TRUE(Z3Solver_->mustBeTrue(Query(Unrelated, UgtExpr::create(X, C(3))),
+                                    Result));
+  EXPECT_FALSE(Result);
+  ASSERT_TRUE(Z3Solver_->mayBeTrue(Query(Unrelated, EqExpr::create(X, C(1))),
+                                   Result));
+  EXPECT_TRUE(Result);
+
+  // A batch uses the same constraints, and leaves them asserted
+  const std::vector<ref<Expr>> Exprs{EqExpr::create(X, C(1)),
+                                     EqExpr::create(X, C(4)),
+                                     EqExpr::create(X, C(0))};
+  std::vector<bool> Results;
+  ASSERT_TRUE(Z3Solver_->mayBeTrue(Unrelated, Exprs, Results));
+  EXPECT_EQ(std::vector<bool>({true, false, true}), Results);
+  ASSERT_TRUE(Z3Solver_->mustBeTrue(Query(Unrelated, UltExpr::create(X, C(2))),
+                                    Result));
+  EXPECT_TRUE(Result);
+}